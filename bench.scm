@@ -0,0 +1,27 @@
+; procedure calls and fixnum arithmetic, see make bench
+
+(define (fib n)
+  (if (< n 2)
+    n
+    (+ (fib (- n 1)) (fib (- n 2)))))
+
+(define (tak x y z)
+  (if (not (< y x))
+    z
+    (tak (tak (- x 1) y z) (tak (- y 1) z x) (tak (- z 1) x y))))
+
+(define (count-primes n)
+  (let loop ((i 2) (count 0))
+    (cond
+      ((> i n) count)
+      ((let prime? ((d 2))
+          (cond
+            ((> (* d d) i) #t)
+            ((= (remainder i d) 0) #f)
+            (else (prime? (+ d 1)))))
+        (loop (+ i 1) (+ count 1)))
+      (else (loop (+ i 1) count)))))
+
+(fib 22)
+(tak 18 12 6)
+(count-primes 20000)
@@ -3,6 +3,16 @@
 #include "obj.h"
 
 namespace Dynamic {
-	template<typename C> C *as(Obj *obj) { return dynamic_cast<C *>(obj); }
-	template<typename C> bool is(Obj *obj) { return as<C>(obj); }
+	// C covers the tags from C::first_tag to C::last_tag
+	template<typename C> bool is(Obj *obj) {
+		if (! obj) { return false; }
+		auto tag { tag_of(obj) };
+		return tag >= C::first_tag && tag <= C::last_tag;
+	}
+
+	// immediates are not objects of any class
+	template<typename C> C *as(Obj *obj) {
+		return ! is_immediate(obj) && is<C>(obj) ?
+			static_cast<C *>(obj) : nullptr;
+	}
 }
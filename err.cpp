@@ -7,6 +7,11 @@ void Error::propagate_mark() {
 	mark(data2_);
 }
 
+void Error::forward_references() {
+	forward(data1_);
+	forward(data2_);
+}
+
 Error::Error(
 	const std::string &raiser, const std::string &message,
 	Obj *data1, Obj *data2
@@ -17,6 +17,7 @@ class Error : public Obj {
 		Obj *data2_;
 	protected:
 		void propagate_mark() override;
+		void forward_references() override;
 	public:
 		Error(
 			const std::string &raiser, const std::string &message,
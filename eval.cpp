@@ -1,28 +1,33 @@
 #include "eval.h"
+#include "syntax.h"
+#include "vm.h"
 #include "parser.h"
+#include "stack.h"
 #include "err.h"
 #include "num.h"
 #include "int.h"
 
+#include <algorithm>
+
 std::ostream &Primitive::write(std::ostream &out) {
 	return out << "#primitive";
 }
 
-static inline Obj *beginify(Obj *rest) { return cons(Symbol::get("begin"), rest); }
-
-void Procedure::add_case(Obj *args, Obj *body) {
-	cases_.emplace_back(args, beginify(body));
+static inline Obj *beginify(Obj *rest) {
+	return cons(Symbol::get(Special::begin), rest);
 }
 
 std::ostream &Procedure::write(std::ostream &out) {
-	if (cases_.size() == 1) {
-		out << "(lambda " << cases_[0].args;
-		if (is_pair(cdr(cases_[0].body))) {
+	auto &layouts { cases_->layouts() };
+	if (layouts.size() == 1) {
+		auto body { layouts[0]->body() };
+		out << "(lambda " << layouts[0]->params();
+		if (is_pair(cdr(body))) {
 			out << "\n  ";
-			write_inner_complex_pair(out, as_pair(cdr(cases_[0].body)), " ");
+			write_inner_complex_pair(out, as_pair(cdr(body)), " ");
 		}
 		else {
-			out << " . " << cdr(cases_[0].body);
+			out << " . " << cdr(body);
 		}
 		out << ')';
 	} else {
@@ -54,57 +59,80 @@ class Frame_Guard {
 		~Frame_Guard() { reset(); }
 };
 
-Frame *Procedure::build_env(Procedure_Case &c, Obj *arg_values) {
-	auto new_env { new Frame { env_ } };
+// the parameters were checked by the analysis, they occupy the first
+// slots of the frame
+Frame *Procedure::build_env(Layout *layout, Obj *arg_values) {
+	auto new_env { Frame::create(env_, layout) };
 
-	Obj *cur { c.args };
+	unsigned slot { 0 };
+	Obj *cur { layout->params() };
 	for (; is_pair(cur); cur = cdr(cur)) {
-		auto sym { assert_sym(car(cur)) };
-		ASSERT(sym, "build_env");
-		auto value { car(arg_values) };
-		new_env->insert(sym->value(), value);
+		new_env->init(slot++, car(arg_values));
 		arg_values = cdr(arg_values);
 	}
+	if (cur) { new_env->init(slot, arg_values); }
+	return new_env;
+}
+
+Frame *Procedure::build_env(Layout *layout, Obj *const *args, unsigned count) {
+	auto new_env { Frame::create(env_, layout) };
+
+	unsigned slot { 0 };
+	Obj *cur { layout->params() };
+	for (; is_pair(cur); cur = cdr(cur), ++slot) {
+		new_env->init(slot, args[slot]);
+	}
 	if (cur) {
-		auto sym { assert_sym(cur) };
-		ASSERT(sym, "build_env");
-		new_env->insert(sym->value(), arg_values);
+		Obj *rest { nullptr };
+		for (auto i { count }; i > slot; --i) { rest = cons(args[i - 1], rest); }
+		new_env->init(slot, rest);
 	}
 	return new_env;
 }
 
-Obj *Procedure::get_body(Procedure_Case &c) {
-	return c.body;
+Layout *Procedure::select(Obj *arg_values) {
+	unsigned count { 0 };
+	for (auto lst { arg_values }; is_pair(lst); lst = cdr(lst)) { ++count; }
+	auto layout { cases_->select(count) };
+	if (! layout) { err("procedure-apply", "no match", arg_values); }
+	return layout;
 }
 
-bool matches(Obj *args, Obj *values) {
-	if (! args) { return values == nullptr; }
-	auto pa { as_pair(args) };
-	if (! pa) { return true; }
-	auto pv { as_pair(values) };
-	if (! pv) { return false; }
-	return matches(cdr(pa), cdr(pv));
-
+Layout *Procedure::select(Obj *const *args, unsigned count) {
+	auto layout { cases_->select(count) };
+	if (! layout) {
+		Obj *arg_values { nullptr };
+		for (auto i { count }; i; --i) { arg_values = cons(args[i - 1], arg_values); }
+		err("procedure-apply", "no match", arg_values);
+	}
+	return layout;
 }
 
-bool case_matches(const Procedure_Case &c, Obj *arg_values) {
-	return matches(c.args, arg_values);
-}
+Engine engine { Engine::tree };
 
 Obj *Procedure::apply(Obj *arg_values) {
-	for (auto &c : cases_) {
-		if (case_matches(c, arg_values)) {
-			auto new_env { build_env(c, arg_values) };
-			ASSERT(new_env, "procedure apply");
-			{
-				Frame_Guard fg { new_env };
-				return eval(get_body(c), new_env);
-			}
-		}
-	}
+	auto layout { select(arg_values) };
+	Local_Frames::Guard local_guard;
+	auto new_env { build_env(layout, arg_values) };
+	Frame_Guard fg { new_env };
+	if (engine == Engine::vm) { return execute(layout, new_env); }
+	return run(layout->code(), new_env);
+}
 
-	err("procedure-apply", "no match", arg_values);
-	return nullptr;
+Obj *Procedure::apply_values(Obj *const *values, unsigned count) {
+	auto layout { select(values, count) };
+	Local_Frames::Guard local_guard;
+	auto new_env { build_env(layout, values, count) };
+	Frame_Guard fg { new_env };
+	if (engine == Engine::vm) { return execute(layout, new_env); }
+	return run(layout->code(), new_env);
+}
+
+Obj *Function::apply_values(Obj *const *values, unsigned count) {
+	Obj *args { nullptr };
+	for (auto i { count }; i; --i) { args = cons(values[i - 1], args); }
+	Root args_root { args };
+	return apply(args);
 }
 
 Obj *apply(Obj *op, Obj *operands) {
@@ -113,31 +141,120 @@ Obj *apply(Obj *op, Obj *operands) {
 	return fn->apply(operands);
 }
 
-Obj *eval_list(Obj *exp, Frame *env) {
-	if (! exp) { return exp; }
-	auto head { eval(car(exp), env) };
-	if (auto rest { as_pair(cdr(exp)) }) {
-		return cons(head, eval_list(rest, env));
-	} else {
-		return cons(head, eval(cdr(exp), env));
+Obj *apply_primitive { nullptr };
+
+// the last argument of apply is a list of further arguments
+Node *apply_step(Frame *&env, Obj *&value, Obj *fn, Obj *const *args, unsigned count) {
+	if (auto proc { as_procedure(fn) }) {
+		auto layout { proc->select(args, count) };
+		env = proc->build_env(layout, args, count);
+		return layout->code();
+	}
+	if (fn == apply_primitive) {
+		ASSERT(count >= 2, "apply");
+		auto rest { args[count - 1] };
+		unsigned spread_count { count - 2 };
+		for (auto cur { rest }; is_pair(cur); cur = cdr(cur)) { ++spread_count; }
+		Arguments spread { spread_count };
+		auto values { std::copy(args + 1, args + count - 1, spread.values()) };
+		for (; is_pair(rest); rest = cdr(rest)) { *values++ = car(rest); }
+		ASSERT(is_null(rest), "apply");
+		return apply_step(env, value, args[0], spread.values(), spread_count);
 	}
+	auto function { as_function(fn) };
+	ASSERT(function, "apply");
+	value = function->apply_values(args, count);
+	return nullptr;
 }
 
-Symbol *first_symbol(Obj *lst) {
-	return as_symbol(car(lst));
+namespace {
+	constexpr std::size_t segment_size { 1024 };
+
+	// the segments keep their capacity, only the used part is live
+	std::vector<std::vector<Obj *>> segments;
+	std::size_t current { 0 };
 }
 
-bool is_tagged_list(Obj *lst, const std::string &tag) {
-	auto sym { first_symbol(lst) };
-	return sym && sym->value() == tag;
+Arguments::Arguments(unsigned count) {
+	if (segments.empty()) {
+		segments.emplace_back();
+		segments.back().reserve(segment_size);
+	}
+	segment_ = current;
+	size_ = segments[current].size();
+	if (size_ + count > segments[current].capacity()) {
+		if (++current == segments.size()) { segments.emplace_back(); }
+		auto &segment { segments[current] };
+		segment.clear();
+		segment.reserve(std::max<std::size_t>(segment_size, count));
+	}
+	auto &segment { segments[current] };
+	auto first { segment.size() };
+	segment.resize(first + count, nullptr);
+	values_ = segment.data() + first;
+}
+
+Arguments::~Arguments() {
+	while (current > segment_) { segments[current--].clear(); }
+	segments[current].resize(size_);
+}
+
+void Arguments::foreach(std::function<void(Obj *)> fn) {
+	for (std::size_t i { 0 }; i < segments.size() && i <= current; ++i) {
+		for (auto obj : segments[i]) {
+			if (obj && ! is_immediate(obj)) { fn(obj); }
+		}
+	}
+}
+
+Obj *Continuation::apply(Obj *args) {
+	ASSERT(is_pair(args) && ! cdr(args), "continuation");
+	write_barrier(value_, car(args));
+	value_ = car(args);
+	escape();
+}
+
+Obj *Continuation::apply_values(Obj *const *values, unsigned count) {
+	ASSERT(count == 1, "continuation");
+	write_barrier(value_, values[0]);
+	value_ = values[0];
+	escape();
+}
+
+void Continuation::escape() {
+	if (! active_) { err("continuation", "not active", this); }
+	throw Escape { this };
+}
+
+// the escapes of inner continuations pass through
+Obj *Continuation::call_with(Obj *fn) {
+	auto function { as_function(fn) };
+	ASSERT(function, "call-with-escape-continuation");
+	Obj *k { new Continuation { } };
+	Root k_root { k };
+	auto continuation { static_cast<Continuation *>(k) };
+	continuation->active_ = true;
+	try {
+		auto value { function->apply_values(&k, 1) };
+		continuation->active_ = false;
+		return value;
+	} catch (const Escape &escape) {
+		continuation->active_ = false;
+		if (escape.continuation != continuation) { throw; }
+		return continuation->value_;
+	} catch (...) {
+		continuation->active_ = false;
+		throw;
+	}
 }
 
-inline bool is_define_special(Pair *lst) {
-	return is_tagged_list(lst, "define");
+Symbol *first_symbol(Obj *lst) {
+	return as_symbol(car(lst));
 }
 
-inline bool is_define_syntax_special(Obj *lst) {
-	return is_tagged_list(lst, "define-syntax");
+Special special_of(Obj *lst) {
+	auto sym { first_symbol(lst) };
+	return sym ? sym->special() : Special::none;
 }
 
 inline Obj *define_key(Pair *lst) {
@@ -152,19 +269,6 @@ inline Obj *define_key(Pair *lst) {
 	return nullptr;
 }
 
-inline Obj *define_value(Pair *lst, Frame *env) {
-	if (auto args { as_pair(cadr(lst)) }) {
-		return new Procedure { cdr(args), cddr(lst), env };
-	} else {
-		ASSERT(is_null(cdddr(lst)), "define");
-		return eval(caddr(lst), env);
-	}
-}
-
-inline bool is_lambda_special(Pair *lst) {
-	return is_tagged_list(lst, "lambda");
-}
-
 inline Obj *lambda_args(Pair *lst) {
 	return cadr(lst);
 }
@@ -173,18 +277,10 @@ inline Obj *lambda_body(Pair *lst) {
 	return cddr(lst);
 }
 
-inline bool is_case_lambda_special(Pair *lst) {
-	return is_tagged_list(lst, "case-lambda") && is_pair(cdr(lst));
-}
-
 inline Obj *case_lambda_cases(Pair *lst) {
 	return cdr(lst);
 }
 
-inline bool is_if_special(Pair *lst) {
-	return is_tagged_list(lst, "if");
-}
-
 inline Obj *if_condition(Pair *lst) {
 	return cadr(lst);
 }
@@ -197,85 +293,6 @@ inline Obj *if_alternative(Pair *lst) {
 	return cadddr(lst);
 }
 
-inline bool is_cond_special(Pair *lst) {
-	return is_tagged_list(lst, "cond");
-}
-
-Obj *build_cond(Obj *lst) {
-	if (is_null(lst)) { return lst; }
-	auto expr { car(lst) };
-	auto cond { car(expr) };
-	auto cons { cdr(expr) };
-	auto sym { as_symbol(cond) };
-	if (sym && sym->value() == "else") {
-		if (cdr(lst)) {
-			err("cond", "else not in last case");
-		}
-		return beginify(cons);
-	}
-	return build_list(Symbol::get("if"), cond, beginify(cons), build_cond(cdr(lst)));
-}
-
-inline bool is_begin_special(Pair *lst) {
-	return is_tagged_list(lst, "begin");
-}
-
-inline bool is_and_special(Pair *lst) {
-	return is_tagged_list(lst, "and");
-}
-
-inline bool is_or_special(Pair *lst) {
-	return is_tagged_list(lst, "or");
-}
-
-inline bool is_quote_special(Pair *lst) {
-	return is_tagged_list(lst, "quote");
-}
-
-inline bool is_let_special(Pair *lst) {
-	return is_tagged_list(lst, "let");
-}
-
-Obj *build_let_args(Obj *arg_vals, Obj *args) {
-	if (is_null(arg_vals)) { return args; }
-	args = build_let_args(cdr(arg_vals), args);
-	return cons(car(car(arg_vals)), args);
-}
-
-Obj *build_let_vals(Obj *arg_vals, Obj *vals) {
-	if (is_null(arg_vals)) { return vals; }
-	vals = build_let_vals(cdr(arg_vals), vals);
-	return cons(cadr(car(arg_vals)), vals);
-}
-
-Obj *build_let(Obj *lst) {
-	lst = cdr(lst);
-	auto name { as_symbol(car(lst)) };
-	if (name) { lst = cdr(lst); };
-	auto arg_vals { car(lst) };
-	auto block { cdr(lst) };
-	auto args { build_let_args(arg_vals, nullptr) };
-	auto vals { build_let_vals(arg_vals, nullptr) };
-	auto lambda { cons(Symbol::get("lambda"), cons(args, block))};
-	if (name) {
-		auto inner_arg = build_list(name);
-		auto inner_set = build_list(
-			Symbol::get("set!"), name, lambda
-		);
-		auto inner_call = cons(name, vals);
-		auto inner = build_list(
-			Symbol::get("lambda"), inner_arg, inner_set, inner_call
-		);
-		return build_list(inner, false_obj);
-	} else {
-		return cons(lambda, vals);
-	}
-}
-
-bool is_set_special(Pair *lst) {
-	return is_tagged_list(lst, "set!");
-}
-
 Obj *set_var(Obj *lst) { return cadr(lst); }
 Obj *set_value(Obj *lst) { return caddr(lst); }
 
@@ -283,352 +300,347 @@ bool is_valid_set(Pair *lst) {
 	return is_null(cdddr(lst));
 }
 
-bool is_assert_special(Pair * lst) {
-	return is_tagged_list(lst, "assert");
-}
-
 bool is_valid_assert(Pair *lst) {
 	return is_null(cddr(lst));
 }
 
-class Active_Guard {
-		Obj **elm_;
-	public:
-		Active_Guard(Obj **elm) : elm_ { elm } {
-			if (*elm_) { (*elm_)->make_active(); };
+// the internal definitions of a procedure body get slots in its
+// layout before the body is analyzed
+
+// calls fn for each cell whose car is evaluated in the frame of body
+// forms that get a frame of their own are not entered
+template<typename FN> void foreach_cell(Obj *lst, FN &fn);
+
+template<typename FN> void foreach_inner_cell(Pair *form, FN &fn) {
+	if (find_syntax_extension(form)) { return; }
+	auto special { special_of(form) };
+	switch (special) {
+		case Special::quote: case Special::lambda: case Special::case_lambda:
+		case Special::define_syntax: case Special::syntax_rules:
+			return;
+		case Special::define:
+			if (is_symbol(cadr(form))) { foreach_cell(cddr(form), fn); }
+			return;
+		case Special::let: {
+			// named let evaluates even its values in a frame of its own
+			auto bindings { cadr(form) };
+			if (is_symbol(bindings)) { return; }
+			for (; is_pair(bindings); bindings = cdr(bindings)) {
+				if (auto binding { as_pair(car(bindings)) }) {
+					foreach_cell(cdr(binding), fn);
+				}
+			}
+			return;
 		}
-		~Active_Guard() { if (*elm_) { (*elm_)->cease_active(); } }
-		void swap(Obj *el) {
-			if (el) { el->make_active(); }
-			if (*elm_) { (*elm_)->cease_active(); }
-			*elm_ = el;
+		case Special::cond:
+			for (auto cur { cdr(form) }; is_pair(cur); cur = cdr(cur)) {
+				auto clause { as_pair(car(cur)) };
+				if (! clause) { continue; }
+				auto sym { as_symbol(car(clause)) };
+				bool is_else { sym && sym->special() == Special::else_ };
+				foreach_cell(is_else ? cdr(clause) : clause, fn);
+			}
+			return;
+		default:
+			foreach_cell(special == Special::none ? form : cdr(form), fn);
+	}
+}
+
+template<typename FN> void foreach_cell(Obj *lst, FN &fn) {
+	for (; is_pair(lst); lst = cdr(lst)) {
+		auto cell { as_pair(lst) };
+		fn(cell);
+		if (auto form { as_pair(car(cell)) }) {
+			foreach_inner_cell(form, fn);
 		}
-};
+	}
+}
 
-bool evals_to_self(Obj *obj) {
-	if (is_symbol(obj)) { return false; }
-	if (is_pair(obj)) { return false; }
-	return true;
+static void add_param(Layout *layout, Obj *param) {
+	auto sym { assert_sym(param) };
+	if (layout->find(sym) >= 0) { err("lambda", "duplicate parameter", sym); }
+	layout->add(sym);
 }
 
-struct Syntax_Rule {
-	Syntax_Rule(Obj *p, Obj *r): pattern { p }, replacement { r } { }
-	Obj *pattern;
-	Obj *replacement;
-};
+// turns expressions into nodes
+// the layouts of the procedures around the expression are the scopes
+// variables that are in no scope are top-level variables of global
+// syntax extensions are defined during the analysis, so they can be
+// used in the following expressions
+class Analyzer {
+		Frame *global_;
+		std::vector<Layout *> scopes_;
+		// the number of lambdas in the analyzed code
+		unsigned lambdas_ { 0 };
 
-#include <set>
+		Lambda_Node *new_lambda() {
+			++lambdas_;
+			return new Lambda_Node { };
+		}
 
-class Syntax_State {
-		std::map<std::string, Obj *> single_;
-		std::map<std::string, Obj *> repeating_;
-	public:
-		void add(const std::string &key, Obj *value, bool repeating) {
-			if (repeating) {
-				repeating_[key] = cons(value, repeating_[key]);
-			} else {
-				single_[key] = value;
+		Node *variable(Symbol *sym) {
+			unsigned depth { 0 };
+			for (auto i { scopes_.rbegin() }; i != scopes_.rend(); ++i, ++depth) {
+				int slot { (*i)->find(sym) };
+				if (slot >= 0) { return new Local_Node { depth, unsigned(slot), sym }; }
 			}
+			return new Global_Node { global_->cell(sym) };
 		}
-		Obj *get(const std::string &key, bool repeating) {
-			return (repeating ? repeating_ : single_)[key];
-		}
-};
 
-class Syntax : public Obj {
-	public:
-		const std::string name_;
-		std::set<std::string> keywords_;
-		std::vector<Syntax_Rule> rules_;
-		bool is_repeating(Obj *cur) {
-			auto nxt { as_pair(cdr(cur)) };
-			if (! nxt) { return false; }
-			auto sym { as_symbol(car(nxt)) };
-			return sym && sym->value() == "...";
-		}
-		Syntax_State *match_one(Obj *pattern, Obj *value, Syntax_State *match, bool repeating) {
-			auto pair { as_pair(pattern) };
-			if (pair) {
-				auto vp { as_pair(value) };
-				if (! vp) { return nullptr; }
-				return match_rest(pair, vp, match, repeating);
-			}
-			auto sym { as_symbol(pattern) };
-			if (sym) {
-				if (keywords_.find(sym->value()) != keywords_.end()) {
-					if (value == sym) {
-						if (! match) {
-							match = new Syntax_State { };
-						}
-						return match;
-					} else { return nullptr; }
-				}
-				if (! match) { match = new Syntax_State { }; }
-				match->add(sym->value(), value, repeating);
-				return match;
+		bool is_local(Symbol *sym) {
+			for (auto layout : scopes_) {
+				if (layout->find(sym) >= 0) { return true; }
 			}
-			return nullptr;
+			return false;
 		}
-		Syntax_State *match_rest(Obj *pattern, Obj *values, Syntax_State *match, bool repeating) {
-			for (;;) {
-				if (! pattern) {
-					if (values) { return nullptr; }
-					if (! match) { match = new Syntax_State { }; }
-					return match;
-				}
-				if (! is_pair(pattern)) { return nullptr; }
-				bool repeating { is_repeating(pattern) };
-				if (! repeating) {
-					if (! is_pair(values)) { return nullptr; }
-					match = match_one(car(pattern), car(values), match, false);
-					if (! match) { return nullptr; }
-					values = cdr(values);
-				} else {
-					while (values) {
-						if (! is_pair(values)) { return nullptr; }
-						match = match_one(car(pattern), car(values), match, true);
-						if (! match) { return nullptr; }
-						values = cdr(values);
-					}
-				}
-				pattern = cdr(pattern);
-				if (repeating) {
-				       	pattern = cdr(pattern);
-					if (! pattern) { err("match-rest", "elements after ...", pattern); return nullptr; }
-			       	}
-			}
 
-		}
-		Syntax_State *build_match(Syntax_Rule &rule, Obj *lst) {
-			return match_rest(rule.pattern, lst, nullptr, false);
-		}
-		Obj *apply_match(Syntax_Rule &rule, Syntax_State *match) {
-			err("syntax", "match not implemented");
-			return nullptr;
-		}
-	protected:
-		void propagate_mark() override {
-			for (auto &r : rules_) {
-				mark(r.pattern);
-				mark(r.replacement);
+		// a call with two arguments of a top-level variable that
+		// holds a primitive with a binary entry
+		Node *binary_call(Pair *lst) {
+			auto sym { first_symbol(lst) };
+			if (! sym || is_local(sym)) { return nullptr; }
+			auto args { cdr(lst) };
+			if (! is_pair(args) || ! is_pair(cdr(args)) || cddr(args)) {
+				return nullptr;
 			}
+			auto cell { global_->cell(sym) };
+			auto primitive { as_primitive(cell->value()) };
+			if (! primitive || ! primitive->binary_entry()) { return nullptr; }
+			return new Binary_Call_Node {
+				cell, primitive, primitive->binary_entry(), analyze_list(args)
+			};
 		}
-	public:
-		Syntax(const std::string name) : name_ { name } { }
-		const std::string &name() const { return name_; }
-		void add_keyword(const std::string &kw) { keywords_.insert(kw); }
-		void add_rule(Obj *pattern, Obj *replacement) {
-			rules_.emplace_back(pattern, replacement);
-		}
-		std::ostream &write(std::ostream &out) override {
-			return out << "#syntax";
-		}
-		Obj *apply(Obj *lst, Frame *env) {
-			for (auto &r : rules_) {
-				auto m { build_match(r, lst) };
-				if (m) {
-					return apply_match(r, m);
-				}
+
+		std::vector<Node *> analyze_list(Obj *lst) {
+			std::vector<Node *> nodes;
+			for (; is_pair(lst); lst = cdr(lst)) {
+				nodes.push_back(analyze(car(lst)));
 			}
-			err("syntax", "no match", lst);
-			return nullptr;
+			ASSERT(is_null(lst), "analyze");
+			return nodes;
 		}
-};
-
-std::map<std::string, Syntax *> syntax_extensions;
 
-Syntax *find_syntax_extension(Obj *lst) {
-	if (auto sym { first_symbol(lst) }) {
-		auto got { syntax_extensions.find(sym->value()) };
-		if (got != syntax_extensions.end()) {
-			return got->second;
+		Node *sequence(Obj *lst) {
+			auto nodes { analyze_list(lst) };
+			ASSERT(! nodes.empty(), "begin");
+			if (nodes.size() == 1) { return nodes.front(); }
+			return new Sequence_Node { std::move(nodes) };
 		}
-	}
-	return nullptr;
-}
 
-#include <cassert>
-
-void syntax_tests() {
-	auto s { new Syntax { "test" } };
-	s->add_keyword("foo");
-	s->add_rule(parse_expression("(_ x)"), parse_expression("(* x x)"));
-	std::cerr << s->rules_[0].pattern << '\n';
-	std::cerr << s->rules_[0].replacement << '\n';
-	auto m1 { s->match_one(parse_expression("foo"), parse_expression("foo"), nullptr, false) };
-	assert(m1 != nullptr);
-	auto m2 { s->match_one(parse_expression("x"), parse_expression("42"), nullptr, false) };
-	assert(m2 != nullptr);
-	assert(is_equal_num(m2->get("x", false), Integer::create(42)));
-	auto m3 { s->match_rest(nullptr, nullptr, nullptr, false) };
-	assert(m3 != nullptr);
-	auto m4 { s->match_rest(parse_expression("(a b)"), parse_expression("(2 3)"), nullptr, false) };
-	assert(m4 != nullptr);
-	assert(is_equal_num(m4->get("a", false), Integer::create(2)));
-	assert(is_equal_num(m4->get("b", false), Integer::create(3)));
-	auto m5 { s->build_match(s->rules_[0], parse_expression("(test 42)")) };
-	assert (m5 != nullptr);
-	std::cerr << "_: " << m5->get("_", false) << '\n';
-}
+		Layout *procedure(Obj *params, Obj *body) {
+			auto layout { new Layout { params, beginify(body) } };
+			auto cur { params };
+			for (; is_pair(cur); cur = cdr(cur)) { add_param(layout, car(cur)); }
+			if (cur) { add_param(layout, cur); }
 
-Obj *eval(Obj *exp, Frame *env) {
-	Frame_Guard frame_guard;
-	Active_Guard exp_guard { &exp };
-	for (;;) {
-		if (evals_to_self(exp)) { return exp; }
-		if (auto sym_value { as_symbol(exp) }) {
-			return env->has(sym_value->value()) ? env->get(sym_value->value()) : exp;
-		}
-		if (auto lst_value { as_pair(exp) }) {
-			if (auto se { find_syntax_extension(lst_value) }) {
-				exp_guard.swap(se->apply(lst_value, env));
-				continue;
-			}
-			if (is_define_special(lst_value)) {
-				auto key { as_symbol(define_key(lst_value)) };
-				auto value { define_value(lst_value, env) };
-				ASSERT(key, "define");
-				env->insert(key->value(), value);
-				return value;
-			}
-			if (is_define_syntax_special(lst_value)) {
-				auto name { as_symbol(cadr(lst_value)) };
-				auto rules { as_pair(caddr(lst_value)) };
-				ASSERT(name && rules && ! cdddr(lst_value), "syntax-rules");
-				ASSERT(is_tagged_list(rules, "syntax-rules"), "ysyntax-rules");
-				auto se { new Syntax { name->value() } };
-				auto keywords { cadr(rules) };
-				for (; keywords; keywords = cdr(keywords)) {
-					ASSERT(is_pair(keywords), "syntax-rules");
-					auto sym { as_symbol(car(keywords)) };
-					ASSERT(sym, "syntax-rules");
-					se->add_keyword(sym->value());
-				}
-				auto cur { cddr(rules) };
-				for (; cur; cur = cdr(cur)) {
-					ASSERT(is_pair(cur), "syntax-rules");
-					auto rule { as_pair(car(cur)) };
-					ASSERT(rule, "syntax-rules");
-					auto pattern { as_pair(car(rule)) };
-					auto replacement { as_pair(cadr(rule)) };
-					ASSERT(pattern && replacement && ! cddr(rule), "syntax-rules");
-					se->add_rule(pattern, replacement);
-				}
-				syntax_extensions[se->name()] = se;
-				return se;
-			}
-			if (is_lambda_special(lst_value)) {
-				auto args { lambda_args(lst_value) };
-				auto body { lambda_body(lst_value) };
-				return new Procedure(args, body, env);
-			}
-			if (is_case_lambda_special(lst_value)) {
-				auto cases { case_lambda_cases(lst_value) };
-				auto proc { new Procedure(env) };
-				for (; is_pair(cases) && is_pair(car(cases)); cases = cdr(cases)) {
-					auto pair { as_pair(car(cases)) };
-					proc->add_case(car(pair), cdr(pair));
+			auto add_define { [layout](Pair *cell) {
+				auto form { as_pair(car(cell)) };
+				if (form && special_of(form) == Special::define) {
+					layout->add(as_symbol(define_key(form)));
 				}
-				return proc;
+			} };
+			foreach_cell(body, add_define);
+
+			auto lambdas { lambdas_ };
+			scopes_.push_back(layout);
+			layout->set_code(sequence(body));
+			scopes_.pop_back();
+			// no procedure can capture a frame of the layout or of
+			// the lets in its body
+			if (lambdas == lambdas_) { layout->set_local(); }
+			return layout;
+		}
+
+		Node *define(Pair *lst) {
+			auto key { as_symbol(define_key(lst)) };
+			ASSERT(key, "define");
+			Node *value;
+			if (auto args { as_pair(cadr(lst)) }) {
+				auto lambda { new_lambda() };
+				lambda->add_case(procedure(cdr(args), cddr(lst)));
+				value = lambda;
+			} else {
+				ASSERT(is_null(cdddr(lst)), "define");
+				value = analyze(caddr(lst));
 			}
-			if (is_if_special(lst_value)) {
-				auto condition { eval(if_condition(lst_value), env) };
-				ASSERT(is_null(cdddr(lst_value)) || is_null(cddddr(lst_value)), "if");
-				if (is_true(condition)) {
-					exp_guard.swap(if_consequence(lst_value));
-					continue;
-				} else {
-					if (is_null(cdddr(lst_value))) {
-						exp_guard.swap(false_obj);
-					} else {
-						exp_guard.swap(if_alternative(lst_value));
-					}
-					continue;
-				}
+			if (scopes_.empty()) {
+				return new Define_Global_Node { global_->cell(key), value };
 			}
-			if (is_cond_special(lst_value)) {
-				exp_guard.swap(build_cond(cdr(lst_value)));
-				continue;
+			// definitions that the scan did not see get a slot now
+			auto layout { scopes_.back() };
+			layout->add(key);
+			return new Define_Local_Node { unsigned(layout->find(key)), value };
+		}
+
+		// the clauses of a cond become nested ifs
+		Node *cond(Obj *clauses) {
+			if (is_null(clauses)) { return new Constant_Node { nullptr }; }
+			auto clause { car(clauses) };
+			auto sym { as_symbol(car(clause)) };
+			if (sym && sym->special() == Special::else_) {
+				if (cdr(clauses)) { err("cond", "else not in last case"); }
+				return sequence(cdr(clause));
 			}
-			if (is_begin_special(lst_value)) {
-				auto cur { cdr(lst_value) };
-				for (; cdr(cur); cur = cdr(cur)) {
-					eval(car(cur), env);
-				}
-				exp_guard.swap(car(cur));
-				continue;
+			auto condition { analyze(car(clause)) };
+			auto consequence { sequence(cdr(clause)) };
+			return new If_Node { condition, consequence, cond(cdr(clauses)) };
+		}
+
+		// a let enters the frame of its body directly
+		// a named let enters a frame that holds the procedure of the
+		// loop and calls it; the values see the name like in
+		// ((lambda (name) (set! name (lambda ...)) (name values...)) #f)
+		Node *let(Pair *lst) {
+			auto rest { cdr(lst) };
+			auto name { as_symbol(car(rest)) };
+			if (name) { rest = cdr(rest); }
+			std::vector<Obj *> names;
+			std::vector<Obj *> values;
+			for (auto cur { car(rest) }; ! is_null(cur); cur = cdr(cur)) {
+				names.push_back(car(car(cur)));
+				values.push_back(cadr(car(cur)));
 			}
-			if (is_and_special(lst_value)) {
-				auto cur { cdr(lst_value) };
-				Obj *result { true_obj };
-				for (; is_true(cur) && cur; cur = cdr(cur)) {
-					result = eval(car(cur), env);
-					if (is_false(result)) { break; }
-				}
-				return result;
+			Obj *params { nullptr };
+			for (auto i { names.size() }; i; --i) { params = cons(names[i - 1], params); }
+			auto block { cdr(rest) };
+			if (! name) {
+				std::vector<Node *> args;
+				for (auto value : values) { args.push_back(analyze(value)); }
+				return new Let_Node { procedure(params, block), std::move(args) };
 			}
-			if (is_or_special(lst_value)) {
-				auto cur { cdr(lst_value) };
-				Obj *result { false_obj };
-				for (; cur; cur = cdr(cur)) {
-					result = eval(car(cur), env);
-					if (is_true(result)) { break; }
+			auto outer { new Layout { nullptr, nullptr } };
+			outer->add(name);
+			scopes_.push_back(outer);
+			auto loop { new_lambda() };
+			loop->add_case(procedure(params, block));
+			std::vector<Node *> args;
+			for (auto value : values) { args.push_back(analyze(value)); }
+			auto call { new Application_Node { variable(name), std::move(args) } };
+			scopes_.pop_back();
+			outer->set_code(new Sequence_Node { { new Define_Local_Node { 0, loop }, call } });
+			return new Let_Node { outer, { } };
+		}
+
+		Node *set(Pair *lst) {
+			ASSERT(is_valid_set(lst), "set!");
+			auto sym { as_symbol(set_var(lst)) };
+			if (! sym) { err("set!", "unknown key", set_var(lst)); }
+			auto value { analyze(set_value(lst)) };
+			unsigned depth { 0 };
+			for (auto i { scopes_.rbegin() }; i != scopes_.rend(); ++i, ++depth) {
+				int slot { (*i)->find(sym) };
+				if (slot >= 0) {
+					return new Set_Local_Node { depth, unsigned(slot), sym, value };
 				}
-				return result;
 			}
-			if (is_quote_special(lst_value)) {
-				return cadr(lst_value);
-			}
-			if (is_let_special(lst_value)) {
-				exp_guard.swap(build_let(lst_value));
-				continue;
+			return new Set_Global_Node { global_->cell(sym), value };
+		}
+
+	public:
+		Analyzer(Frame *global): global_ { global } {
+			ASSERT(! global->layout(), "analyze");
+		}
+
+		Node *analyze(Obj *exp) {
+			if (auto sym { as_symbol(exp) }) { return variable(sym); }
+			auto lst { as_pair(exp) };
+			if (! lst) { return new Constant_Node { exp }; }
+			if (Stack::is_low()) {
+				return Stack::extend([&]() { return analyze(exp); });
 			}
-			if (is_set_special(lst_value)) {
-				ASSERT(is_valid_set(lst_value), "set!");
-				auto sym { as_symbol(set_var(lst_value)) };
-				auto val { eval(set_value(lst_value), env) };
-				if (sym) {
-					return env->update(sym, val);
-				}
-				err("set!", "unknown key", set_var(lst_value));
+			Stack::Depth_Guard depth_guard;
+			if (auto se { find_syntax_extension(lst) }) {
+				return analyze(se->expand(lst));
 			}
-			if (is_assert_special(lst_value)) {
-				ASSERT(is_valid_assert(lst_value), "assert");
-				auto val { eval(cadr(lst_value), env) };
-				if (is_false(val)) {
-					err("assert", "failed", lst_value);
+			switch (special_of(lst)) {
+				case Special::define:
+					return define(lst);
+				case Special::define_syntax:
+					return new Constant_Node { define_syntax(lst) };
+				case Special::lambda: {
+					auto lambda { new_lambda() };
+					lambda->add_case(procedure(lambda_args(lst), lambda_body(lst)));
+					return lambda;
 				}
-				return Symbol::get("ok");
-			}
-			auto lst { eval_list(lst_value, env) };
-			if (auto proc { as_procedure(car(lst)) }) {
-				bool done { false };
-				for (auto &c : proc->cases_) {
-					if (case_matches(c, cdr(lst))) {
-						auto new_env { proc->build_env(c, cdr(lst)) };
-						ASSERT(new_env, "eval apply");
-						env = new_env;
-						exp_guard.swap(proc->get_body(c));
-						done = true;
-						break;
+				case Special::case_lambda: {
+					if (! is_pair(cdr(lst))) { break; }
+					auto lambda { new_lambda() };
+					auto cases { case_lambda_cases(lst) };
+					for (; is_pair(cases) && is_pair(car(cases)); cases = cdr(cases)) {
+						auto pair { as_pair(car(cases)) };
+						lambda->add_case(procedure(car(pair), cdr(pair)));
 					}
+					return lambda;
 				}
-
-				if (done) {
-					continue;
-				} else {
-					err("procedure-apply", "no match", cdr(lst));
+				case Special::if_: {
+					ASSERT(is_null(cdddr(lst)) || is_null(cddddr(lst)), "if");
+					auto alternative { is_null(cdddr(lst)) ?
+						new Constant_Node { false_obj } :
+						analyze(if_alternative(lst))
+					};
+					return new If_Node {
+						analyze(if_condition(lst)),
+						analyze(if_consequence(lst)),
+						alternative
+					};
 				}
+				case Special::cond:
+					return cond(cdr(lst));
+				case Special::begin:
+					return sequence(cdr(lst));
+				case Special::and_:
+					return new And_Node { analyze_list(cdr(lst)) };
+				case Special::or_:
+					return new Or_Node { analyze_list(cdr(lst)) };
+				case Special::quote:
+					return new Constant_Node { cadr(lst) };
+				case Special::let:
+					return let(lst);
+				case Special::set:
+					return set(lst);
+				case Special::assert_:
+					ASSERT(is_valid_assert(lst), "assert");
+					return new Assert_Node { analyze(cadr(lst)), lst };
+				default:
+					break;
 			}
-			return apply(car(lst), cdr(lst));
+			if (auto call { binary_call(lst) }) { return call; }
+			auto function { analyze(car(lst)) };
+			return new Application_Node { function, analyze_list(cdr(lst)) };
+		}
+};
+
+Obj *run(Node *node, Frame *env) {
+	if (Stack::is_low()) {
+		return Stack::extend([=]() { return run(node, env); });
+	}
+	Stack::Depth_Guard depth_guard;
+	Frame_Guard frame_guard;
+	Local_Frames::Guard local_guard;
+	for (;;) {
+		Obj::collect_if_due();
+		Obj *value;
+		auto cur_env { env };
+		node = node->step(env, value);
+		if (! node) { return value; }
+		if (env != cur_env) {
+			frame_guard.set(env);
+			local_guard.tail_call(env);
 		}
-		break;
 	}
-	err("eval", "unknown", exp);
-	return nullptr;
 }
 
-void foreach_syntax_extension(std::function<void(Obj *)> fn) {
-	for (auto &[key, obj] : syntax_extensions) { fn(obj); }
+Node *analyze(Obj *exp, Frame *env) {
+	return Analyzer { env }.analyze(exp);
 }
 
+Obj *eval(Obj *exp, Frame *env) {
+	Obj *node { analyze(exp, env) };
+	Root node_root { node };
+	if (engine == Engine::vm) {
+		Obj *code { compile(as_node(node)) };
+		Root code_root { code };
+		return execute(as_code(code), env);
+	}
+	return run(as_node(node), env);
+}
@@ -1,17 +1,27 @@
 /**
  * evaluate expressions
  * and call functions
- * also special forms are handled
+ * expressions are analyzed into nodes before they are executed,
+ * there the special forms are handled
  */
 
 #pragma once
 
 #include "dynamic.h"
-#include "frame.h"
+#include "node.h"
+
+#include <functional>
 
 class Function : public Obj {
+	protected:
+		Function(Tag tag): Obj { tag } { }
 	public:
+		static constexpr Tag first_tag { Tag::primitive };
+		static constexpr Tag last_tag { Tag::procedure };
 		virtual Obj *apply(Obj *args) = 0;
+		// the values must be rooted by the caller; only functions that
+		// need a list get one
+		virtual Obj *apply_values(Obj *const *values, unsigned count);
 };
 
 constexpr auto as_function = Dynamic::as<Function>;
@@ -19,55 +29,105 @@ constexpr auto is_function = Dynamic::is<Function>;
 
 class Primitive : public Function {
 	public:
+		static constexpr Tag first_tag { Tag::primitive };
+		static constexpr Tag last_tag { Tag::primitive };
+		Primitive(): Function { Tag::primitive } { }
 		std::ostream &write(std::ostream &out) override;
-
+		// calls with two arguments may use this function instead,
+		// see Binary_Call_Node
+		virtual Binary_Entry binary_entry() const { return nullptr; }
 };
 
-struct Procedure_Case {
-	Procedure_Case(Obj *a, Obj *b): args { a }, body { b } { }
-	Obj *args;
-	Obj *body;
-};
+constexpr auto as_primitive = Dynamic::as<Primitive>;
 
+// a procedure has a layout for each case of a case-lambda
 class Procedure : public Function {
 		Frame *env_;
+		Cases *cases_;
 	protected:
-		void propagate_mark() override {
-			mark(env_);
-			for (auto &c : cases_) {
-				mark(c.args);
-				mark(c.body);
-			}
-		}
+		void propagate_mark() override { mark(env_); mark(cases_); }
 	public:
-		std::vector<Procedure_Case> cases_;
-		Procedure(Frame *env): env_ { env } { }
-
-		void add_case(Obj *args, Obj *body);
+		static constexpr Tag first_tag { Tag::procedure };
+		static constexpr Tag last_tag { Tag::procedure };
+		Procedure(Frame *env, Cases *cases):
+			Function { Tag::procedure }, env_ { env }, cases_ { cases } { }
 
-		Procedure(Obj *args, Obj *body, Frame *env): env_ { env }
-		{
-			add_case(args, body);
-	       	}
-
-		Frame *build_env(Procedure_Case &c, Obj *arg_values);
-		Obj *get_body(Procedure_Case &c);
+		// the case that matches the number of arguments
+		Layout *select(Obj *arg_values);
+		Layout *select(Obj *const *args, unsigned count);
+		Frame *build_env(Layout *layout, Obj *arg_values);
+		Frame *build_env(Layout *layout, Obj *const *args, unsigned count);
 
 		Obj *apply(Obj *arg_values) override;
+		Obj *apply_values(Obj *const *values, unsigned count) override;
 		std::ostream &write(std::ostream &out) override;
 };
 
 constexpr auto as_procedure = Dynamic::as<Procedure>;
 constexpr auto is_procedure = Dynamic::is<Procedure>;
 
+// the tree engine runs the nodes, the vm engine their bytecode
+enum class Engine { tree, vm };
+extern Engine engine;
+
+// the node of exp in the top-level frame env
+Node *analyze(Obj *exp, Frame *env);
 Obj *eval(Obj *exp, Frame *env);
 
 extern std::vector<Frame *> active_frames;
 
 Obj *apply(Obj *op, Obj *operands);
 
-#include <functional>
+// the primitive apply; the engines call its function themselves, so
+// that a call of apply in tail position is a tail call
+extern Obj *apply_primitive;
+
+// a call in tail position: a procedure gets its frame in env and its
+// code is returned; other functions set value and return nullptr
+// the args must be rooted by the caller
+Node *apply_step(Frame *&env, Obj *&value, Obj *fn, Obj *const *args, unsigned count);
+
+// room for the values of count arguments while the object lives
+// the values are roots; the stack grows in segments, so the values of
+// a call do not move while further calls are made
+class Arguments {
+		std::size_t segment_;
+		std::size_t size_;
+		Obj **values_;
+	public:
+		Arguments(unsigned count);
+		~Arguments();
+		Arguments(const Arguments &) = delete;
+		Arguments &operator=(const Arguments &) = delete;
+		Obj **values() const { return values_; }
+		static void foreach(std::function<void(Obj *)> fn);
+};
 
-void foreach_syntax_extension(std::function<void(Obj *)> fn);
+// a continuation only escapes: it returns its argument from the
+// call of call-with-escape-continuation that created it, as long as
+// this call is active; call-with-current-continuation is not
+// provided, because a continuation can not be entered again
+// the escape is an exception, so the guards of the C++ calls in
+// between clean up like they do for errors
+class Continuation : public Primitive {
+		bool active_ { false };
+		Obj *value_ { nullptr };
+	protected:
+		void propagate_mark() override { mark(value_); }
+		void forward_references() override { forward(value_); }
+	public:
+		Obj *apply(Obj *args) override;
+		Obj *apply_values(Obj *const *values, unsigned count) override;
+		[[noreturn]] void escape();
+		std::ostream &write(std::ostream &out) override {
+			return out << "#continuation";
+		}
+
+		// call fn with a new continuation
+		static Obj *call_with(Obj *fn);
+};
 
-void syntax_tests();
+// thrown by an escape, caught by the call that created continuation
+struct Escape {
+	Continuation *continuation;
+};
@@ -1,43 +1,238 @@
 #include "frame.h"
+#include "vm.h"
 #include "err.h"
 
+#include <algorithm>
+
+Layout::Layout(Obj *params, Obj *body):
+	Obj { Tag::layout }, params_ { params }, body_ { body }
+{
+	for (; is_pair(params); params = cdr(params)) { ++required_; }
+	rest_ = params != nullptr;
+}
+
+void Layout::propagate_mark() {
+	mark(params_);
+	mark(body_);
+	mark(code_);
+	mark(bytecode_);
+}
+
+void Layout::set_code(Node *code) {
+	write_barrier(code_, code);
+	code_ = code;
+}
+
+void Layout::set_bytecode(Code *bytecode) {
+	write_barrier(bytecode_, bytecode);
+	bytecode_ = bytecode;
+}
+
+void Layout::add(Symbol *name) {
+	if (find(name) < 0) { names_.push_back(name); }
+}
+
+int Layout::find(Symbol *name) const {
+	for (unsigned i { 0 }; i < names_.size(); ++i) {
+		if (names_[i] == name) { return i; }
+	}
+	return -1;
+}
+
+std::ostream &Layout::write(std::ostream &out) {
+	return out << params_;
+}
+
+void Cases::propagate_mark() {
+	for (auto layout : layouts_) { mark(layout); }
+}
+
+void Cases::add(Layout *layout) {
+	layouts_.push_back(layout);
+	write_barrier(nullptr, layout);
+	if (layout->has_rest() && ! variadic_) { variadic_ = layout; }
+	unsigned size { 0 };
+	for (auto l : layouts_) { size = std::max(size, l->required() + 1); }
+	by_count_.assign(size, nullptr);
+	for (unsigned count { 0 }; count < size; ++count) {
+		for (auto l : layouts_) {
+			if (l->accepts(count)) { by_count_[count] = l; break; }
+		}
+	}
+}
+
+namespace {
+	class Unbound : public Obj {
+		public:
+			std::ostream &write(std::ostream &out) override {
+				return out << "#unbound";
+			}
+	};
+}
+
+Obj *const Frame::unbound { new Unbound { } };
+
+Frame::Frame(Frame *next, Layout *layout):
+	Obj { Tag::frame }, next_ { next }, layout_ { layout },
+	slots_(layout ? layout->names().size() : 0, unbound)
+{ }
+
+Frame *Frame::create(Frame *next, Layout *layout) {
+	if (layout->is_local()) { return Local_Frames::acquire(next, layout); }
+	return new Frame { next, layout };
+}
+
+// the slots keep their capacity
+void Frame::reuse(Frame *next, Layout *layout) {
+	next_ = next;
+	layout_ = layout;
+	slots_.assign(layout->names().size(), unbound);
+}
+
+namespace {
+	std::vector<Frame *> local_frames;
+	std::size_t local_top { 0 };
+}
+
+// the frames of the region are allocated once and never deleted
+Frame *Local_Frames::acquire(Frame *next, Layout *layout) {
+	if (local_top == local_frames.size()) {
+		auto frame { ::new Frame { nullptr } };
+		frame->local_ = true;
+		frame->pin_mark();
+		local_frames.push_back(frame);
+	}
+	auto frame { local_frames[local_top++] };
+	frame->reuse(next, layout);
+	return frame;
+}
+
+std::size_t Local_Frames::top() {
+	return local_top;
+}
+
+void Local_Frames::cut(std::size_t top) {
+	local_top = std::min(local_top, top);
+}
+
+// frames that are not local are never nested in local frames
+// a new local frame is the last one acquired, it moves down to top
+void Local_Frames::tail_call(std::size_t top, Frame *frame) {
+	if (frame->next() && frame->next()->is_local()) { return; }
+	if (! frame->is_local()) { cut(top); return; }
+	ASSERT(local_top > top && local_frames[local_top - 1] == frame, "tail call");
+	std::swap(local_frames[top], local_frames[local_top - 1]);
+	local_top = top + 1;
+}
+
+void Local_Frames::foreach(std::function<void(Obj *)> fn) {
+	for (std::size_t i { 0 }; i < local_top; ++i) { fn(local_frames[i]); }
+}
+
 void Frame::propagate_mark() {
-	for (auto &[key, obj] : elements_) {
+	for (auto obj : slots_) {
 		mark(obj);
 	}
+	for (auto &[key, cell] : more_) {
+		mark(cell);
+	}
+	mark(layout_);
 	mark(next_);
 }
 
+void Frame::forward_references() {
+	for (auto &obj : slots_) {
+		forward(obj);
+	}
+}
+
 std::ostream &Frame::write(std::ostream &out) {
 	return out << "#frame";
 }
 
-void Frame::insert(const std::string &key, Obj *value) {
-	elements_[key] = value;
+Frame *Frame::up(unsigned depth) {
+	auto frame { this };
+	for (; depth; --depth) { frame = frame->next_; }
+	return frame;
 }
 
-bool Frame::has(const std::string &key) const {
-	auto it { elements_.find(key) };
-	return it != elements_.end() ? true :
-		next_ ? next_->has(key) : false;
+void Frame::insert(Symbol *key, Obj *value) {
+	ASSERT(key, "insert");
+	int idx { layout_ ? layout_->find(key) : -1 };
+	if (idx < 0) { cell(key)->set(value); return; }
+	write_barrier(slots_[idx], value);
+	slots_[idx] = value;
 }
 
-Obj *Frame::get(const std::string &key) const {
-	auto it { elements_.find(key) };
-	return it != elements_.end() ? it->second :
-		next_ ? next_->get(key) : nullptr;
+Cell *Frame::cell(Symbol *key) {
+	auto &cell { more_[key] };
+	if (! cell) {
+		cell = new Cell { key };
+		write_barrier(nullptr, cell);
+	}
+	return cell;
+}
+
+int Frame::bound_slot(Symbol *key) const {
+	int idx { layout_ ? layout_->find(key) : -1 };
+	return idx >= 0 && slots_[idx] != unbound ? idx : -1;
+}
+
+Cell *Frame::bound_cell(Symbol *key) const {
+	if (more_.empty()) { return nullptr; }
+	auto it { more_.find(key) };
+	return it != more_.end() && it->second->is_bound() ? it->second : nullptr;
+}
+
+Obj **Frame::find(Symbol *key) {
+	for (auto frame { this }; frame; frame = frame->next_) {
+		int idx { frame->bound_slot(key) };
+		if (idx >= 0) { return &frame->slots_[idx]; }
+		if (auto cell { frame->bound_cell(key) }) { return &cell->slot(); }
+	}
+	return nullptr;
+}
+
+Obj *Frame::get(unsigned depth, unsigned slot, Symbol *name) {
+	auto frame { up(depth) };
+	auto value { frame->slots_[slot] };
+	if (value != unbound) { return value; }
+	// the definition was not evaluated yet, so outer bindings are seen
+	auto outer { frame->next_ ? frame->next_->find(name) : nullptr };
+	return outer ? *outer : name;
 }
 
 Obj *Frame::update(Symbol *key, Obj *value) {
 	ASSERT(key, "update");
-	auto it { elements_.find(key->value()) };
-	if (it != elements_.end()) {
-		it->second = value;
-		return value;
-	} else if (next_) {
-		return next_->update(key, value);
-	} else {
-		err("update", "not found", key);
-		return nullptr;
+	for (auto frame { this }; frame; frame = frame->next_) {
+		int idx { frame->bound_slot(key) };
+		if (idx >= 0) {
+			frame->write_barrier(frame->slots_[idx], value);
+			frame->slots_[idx] = value;
+			return value;
+		}
+		if (auto cell { frame->bound_cell(key) }) {
+			cell->set(value);
+			return value;
+		}
 	}
+	err("update", "not found", key);
+	return nullptr;
+}
+
+Obj *Frame::update(unsigned depth, unsigned slot, Symbol *name, Obj *value) {
+	auto frame { up(depth) };
+	auto &cur { frame->slots_[slot] };
+	if (cur == unbound) {
+		ASSERT(frame->next_, "update");
+		return frame->next_->update(name, value);
+	}
+	frame->write_barrier(cur, value);
+	cur = value;
+	return value;
+}
+
+void Frame::define(unsigned slot, Obj *value) {
+	write_barrier(slots_[slot], value);
+	slots_[slot] = value;
 }
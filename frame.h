@@ -1,26 +1,201 @@
 /**
  * store Scheme objects in memory
+ * the frame of a procedure call has a slot for each parameter and
+ * each internal definition; the names of the slots are shared by all
+ * frames of the procedure in a Layout, which also holds the analyzed
+ * body of the procedure
+ * variables of a procedure body are resolved to their slot when the
+ * body is analyzed
+ * top-level bindings are held in a Cell per symbol; references to
+ * them are resolved to their cell, so redefinitions are seen without
+ * a lookup
+ * a layout whose code creates no procedures is local: no frame of it
+ * is referenced after its call returns, so its frames are taken from
+ * a LIFO region instead of the heap
  */
 
 #pragma once
 
 #include "types.h"
-#include <map>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Node;
+class Code;
+
+class Layout : public Obj {
+		Obj *params_;
+		Obj *body_;
+		std::vector<Symbol *> names_;
+		unsigned required_ { 0 };
+		bool rest_ { false };
+		bool local_ { false };
+		Node *code_ { nullptr };
+		Code *bytecode_ { nullptr };
+	protected:
+		void propagate_mark() override;
+		void forward_references() override {
+			forward(params_);
+			forward(body_);
+		}
+	public:
+		static constexpr Tag first_tag { Tag::layout };
+		static constexpr Tag last_tag { Tag::layout };
+		Layout(Obj *params, Obj *body);
+		Obj *params() const { return params_; }
+		Obj *body() const { return body_; }
+		// the arity is computed once from the parameters
+		unsigned required() const { return required_; }
+		bool has_rest() const { return rest_; }
+		bool accepts(unsigned count) const {
+			return count == required_ || (rest_ && count > required_);
+		}
+		bool is_local() const { return local_; }
+		void set_local() { local_ = true; }
+		const std::vector<Symbol *> &names() const { return names_; }
+		void add(Symbol *name);
+		int find(Symbol *name) const;
+		Node *code() const { return code_; }
+		void set_code(Node *code);
+		Code *bytecode() const { return bytecode_; }
+		void set_bytecode(Code *bytecode);
+		std::ostream &write(std::ostream &out) override;
+};
+
+constexpr auto as_layout = Dynamic::as<Layout>;
+
+// the layouts of a lambda or case-lambda; all procedures that are
+// created by the lambda share them and the table that maps each
+// argument count to the first case that accepts it
+class Cases : public Obj {
+		std::vector<Layout *> layouts_;
+		// more arguments than the table covers go to the first case
+		// with a rest parameter
+		std::vector<Layout *> by_count_;
+		Layout *variadic_ { nullptr };
+	protected:
+		void propagate_mark() override;
+	public:
+		void add(Layout *layout);
+		const std::vector<Layout *> &layouts() const { return layouts_; }
+		// nullptr if no case accepts count arguments
+		Layout *select(unsigned count) const {
+			return count < by_count_.size() ? by_count_[count] : variadic_;
+		}
+		std::ostream &write(std::ostream &out) override {
+			return out << "#cases";
+		}
+};
+
+class Cell;
+class Frame;
+
+// the frames of local layouts; they are not on the heap and are
+// reused once their call returned, so they are never garbage
+// the collector visits the live frames like roots
+namespace Local_Frames {
+	Frame *acquire(Frame *next, Layout *layout);
+
+	// the number of live frames; returning calls cut it back
+	std::size_t top();
+	void cut(std::size_t top);
+
+	// frame was entered by a tail call in a call that started at
+	// top; the frames of the replaced calls are released, unless
+	// frame is nested in them
+	void tail_call(std::size_t top, Frame *frame);
+
+	void foreach(std::function<void(Obj *)> fn);
+
+	// releases the frames of the calls that start while it lives
+	class Guard {
+			std::size_t top_;
+		public:
+			Guard(): top_ { top() } { }
+			~Guard() { cut(top_); }
+			Guard(const Guard &) = delete;
+			Guard &operator=(const Guard &) = delete;
+			void tail_call(Frame *frame) { Local_Frames::tail_call(top_, frame); }
+	};
+}
 
 class Frame : public Obj {
+		friend Frame *Local_Frames::acquire(Frame *next, Layout *layout);
+
 		Frame *next_;
-		std::map<std::string, Obj *> elements_;
+		Layout *layout_;
+		bool local_ { false };
+		std::vector<Obj *> slots_;
+		std::unordered_map<Symbol *, Cell *> more_;
+		void reuse(Frame *next, Layout *layout);
+		Frame *up(unsigned depth);
+		int bound_slot(Symbol *key) const;
+		Cell *bound_cell(Symbol *key) const;
 	protected:
 		void propagate_mark() override;
+		void forward_references() override;
 	public:
-		Frame(Frame *next): next_ { next } { }
-		void insert(const std::string &key, Obj *value);
-		bool has(const std::string &key) const;
-		Obj *get(const std::string &key) const;
+		static constexpr Tag first_tag { Tag::frame };
+		static constexpr Tag last_tag { Tag::frame };
+
+		// value of slots whose definition was not evaluated yet
+		static Obj *const unbound;
+
+		Frame(Frame *next, Layout *layout = nullptr);
+		// the frame of a call of layout
+		static Frame *create(Frame *next, Layout *layout);
+		Frame *next() const { return next_; }
+		Layout *layout() const { return layout_; }
+		bool is_local() const { return local_; }
+
+		// only for frames that are not yet visible to the collector
+		void init(unsigned slot, Obj *value) { slots_[slot] = value; }
+
+		void insert(Symbol *key, Obj *value);
+		void insert(const std::string &key, Obj *value) {
+			insert(Symbol::get(key), value);
+		}
+		Obj **find(Symbol *key);
 		Obj *update(Symbol *key, Obj *value);
+
+		// the cell of key in this frame; a new cell is unbound
+		Cell *cell(Symbol *key);
+
+		// access a slot of the frame depth levels up; if the slot is
+		// not defined yet, name is looked up in the frames around it
+		Obj *get(unsigned depth, unsigned slot, Symbol *name);
+		Obj *update(unsigned depth, unsigned slot, Symbol *name, Obj *value);
+		void define(unsigned slot, Obj *value);
+
 		std::ostream &write(std::ostream &out);
 };
 
 constexpr auto as_frame = Dynamic::as<Frame>;
 constexpr auto is_frame = Dynamic::is<Frame>;
 
+class Cell : public Obj {
+		Symbol *name_;
+		Obj *value_;
+	protected:
+		void propagate_mark() override { mark(name_); mark(value_); }
+		void forward_references() override { forward(value_); }
+	public:
+		static constexpr Tag first_tag { Tag::cell };
+		static constexpr Tag last_tag { Tag::cell };
+		Cell(Symbol *name): Obj { Tag::cell }, name_ { name },
+			value_ { Frame::unbound } { }
+		Symbol *name() const { return name_; }
+		bool is_bound() const { return value_ != Frame::unbound; }
+		Obj *value() const { return value_; }
+		Obj *&slot() { return value_; }
+		void set(Obj *value) { write_barrier(value_, value); value_ = value; }
+		std::ostream &write(std::ostream &out) override {
+			return out << name_;
+		}
+};
+
+constexpr auto as_cell = Dynamic::as<Cell>;
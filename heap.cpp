@@ -0,0 +1,402 @@
+#include "heap.h"
+#include "obj.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace {
+	using Heap::page_size;
+	using Heap::Kind;
+
+	constexpr std::size_t granularity { 16 };
+	constexpr std::size_t class_count { 16 };
+
+	struct Free_Slot { Free_Slot *next; };
+
+	struct Page;
+
+	struct Size_Class {
+		Page *pages;
+		Free_Slot *free;
+		char *bump;
+		char *end;
+	};
+
+	struct Page {
+		Kind kind;
+		Page *next;
+		Size_Class *cls;
+		Page *next_young;
+		bool young;
+		bool evacuated;
+		bool unswept;
+		bool empty;
+		std::size_t slot_size;
+		std::size_t slot_count;
+		std::bitset<page_size / granularity> used;
+		char *slot(std::size_t i);
+	};
+
+	constexpr std::size_t header_size {
+		(sizeof(Page) + granularity - 1) / granularity * granularity
+	};
+
+	char *Page::slot(std::size_t i) {
+		return reinterpret_cast<char *>(this) + header_size + i * slot_size;
+	}
+
+	Page *page_of(void *ptr) {
+		return reinterpret_cast<Page *>(
+			reinterpret_cast<std::uintptr_t>(ptr) & ~(page_size - 1)
+		);
+	}
+
+	std::size_t large_bytes(std::size_t size) {
+		return (header_size + size + page_size - 1) / page_size * page_size;
+	}
+
+	std::size_t index_of(Page *page, void *ptr) {
+		return (static_cast<char *>(ptr) - page->slot(0)) / page->slot_size;
+	}
+
+	// after the size classes come the objects that got a page of
+	// their own and the pairs
+	Size_Class classes[class_count + 2];
+	Size_Class &large_class { classes[class_count] };
+	Size_Class &pair_class { classes[class_count + 1] };
+
+	Page *young_pages { nullptr };
+
+	// position of the lazy sweep
+	Size_Class *sweep_class { nullptr };
+	Page *sweep_page { nullptr };
+
+	// pages that the lazy sweep left without objects
+	std::vector<Page *> empty_pages;
+
+	// pair pages during a compaction
+	bool compacting { false };
+	Page *evacuated_pages { nullptr };
+	std::vector<Page *> new_pair_pages;
+
+	void add_young(Page *page, std::size_t bytes) {
+		if (! page->young) {
+			page->young = true;
+			page->next_young = young_pages;
+			young_pages = page;
+		}
+		Heap::used += bytes;
+		Heap::allocated += bytes;
+	}
+
+	void plan_next_collection() {
+		Heap::next_collection = std::max(
+			Heap::initial_size,
+			static_cast<std::size_t>(Heap::used * Heap::growth_factor)
+		);
+	}
+
+	void unlink(Page *page) {
+		for (auto link { &page->cls->pages }; *link; link = &(*link)->next) {
+			if (*link == page) { *link = page->next; break; }
+		}
+	}
+
+	Page *new_page(Size_Class &cls, std::size_t slot_size, std::size_t bytes) {
+		void *mem { std::aligned_alloc(page_size, bytes) };
+		if (! mem) { throw std::bad_alloc { }; }
+		auto page { new (mem) Page { } };
+		page->kind = &cls == &large_class ? Kind::large :
+			&cls == &pair_class ? Kind::pairs : Kind::objects;
+		page->cls = &cls;
+		page->slot_size = slot_size;
+		page->slot_count = (bytes - header_size) / slot_size;
+		page->next = cls.pages;
+		cls.pages = page;
+		if (compacting && &cls == &pair_class) {
+			new_pair_pages.push_back(page);
+		}
+		return page;
+	}
+
+	void delete_page(Page *page) {
+		page->~Page();
+		std::free(page);
+	}
+
+	// the free slots of a page are scattered over the free list of its
+	// class, so empty pages are only released when the sweep ends;
+	// pages that got new objects since are kept
+	void release_empty_pages() {
+		if (empty_pages.empty()) { return; }
+		for (auto page : empty_pages) {
+			auto &cls { *page->cls };
+			page->empty = page->used.none() && ! page->young &&
+				! (cls.bump != cls.end && page_of(cls.bump) == page);
+		}
+		for (auto &cls : classes) {
+			if (std::none_of(
+				empty_pages.begin(), empty_pages.end(),
+				[&](Page *page) { return page->empty && page->cls == &cls; }
+			)) { continue; }
+			for (auto link { &cls.free }; *link; ) {
+				if (page_of(*link)->empty) {
+					*link = (*link)->next;
+				} else { link = &(*link)->next; }
+			}
+			for (auto link { &cls.pages }; *link; ) {
+				auto page { *link };
+				if (page->empty) {
+					*link = page->next;
+					delete_page(page);
+				} else { link = &page->next; }
+			}
+		}
+		empty_pages.clear();
+	}
+
+	void *allocate_slot(Size_Class &cls, std::size_t slot_size) {
+		char *slot;
+		if (cls.free) {
+			slot = reinterpret_cast<char *>(cls.free);
+			cls.free = cls.free->next;
+		} else {
+			if (cls.bump == cls.end) {
+				auto page { new_page(cls, slot_size, page_size) };
+				cls.bump = page->slot(0);
+				cls.end = page->slot(page->slot_count);
+			}
+			slot = cls.bump;
+			cls.bump += slot_size;
+		}
+		auto page { page_of(slot) };
+		page->used.set(index_of(page, slot));
+		add_young(page, slot_size);
+		return slot;
+	}
+}
+
+std::size_t Heap::used { 0 };
+std::size_t Heap::allocated { 0 };
+std::size_t Heap::nursery_size { 256 * 1024 };
+std::size_t Heap::initial_size { 8 * 1024 * 1024 };
+std::size_t Heap::next_collection { 8 * 1024 * 1024 };
+std::size_t Heap::max_size { 0 };
+double Heap::growth_factor { 2.0 };
+std::size_t Heap::slice_budget { 10000 };
+bool Heap::compaction { false };
+
+void *Heap::allocate(std::size_t size) {
+	std::size_t idx { (size + granularity - 1) / granularity };
+	if (idx > class_count) {
+		std::size_t bytes { large_bytes(size) };
+		auto page { new_page(large_class, size, bytes) };
+		page->slot_count = 1;
+		page->used.set(0);
+		add_young(page, bytes);
+		return page->slot(0);
+	}
+	return allocate_slot(classes[idx - 1], idx * granularity);
+}
+
+void *Heap::allocate_pair(std::size_t size) {
+	return allocate_slot(pair_class, size);
+}
+
+void Heap::release(void *ptr) {
+	auto page { page_of(ptr) };
+	page->used.reset(index_of(page, ptr));
+	auto cls { page->cls };
+	if (cls == &large_class) {
+		used -= large_bytes(page->slot_size);
+		if (! page->young) {
+			unlink(page);
+			delete_page(page);
+		}
+		return;
+	}
+	used -= page->slot_size;
+	auto free { static_cast<Free_Slot *>(ptr) };
+	free->next = cls->free;
+	cls->free = free;
+}
+
+std::pair<unsigned, unsigned> Heap::sweep() {
+	unsigned collected { 0 };
+	unsigned kept { 0 };
+	used = allocated = 0;
+	for (; young_pages; young_pages = young_pages->next_young) {
+		young_pages->young = false;
+	}
+	for (auto &cls : classes) {
+		Free_Slot *free { nullptr };
+		Free_Slot **tail { &free };
+		for (auto link { &cls.pages }; *link; ) {
+			auto page { *link };
+			unsigned live { 0 };
+			for (std::size_t i { 0 }; i < page->slot_count; ++i) {
+				if (! page->used[i]) { continue; }
+				auto obj { reinterpret_cast<Obj *>(page->slot(i)) };
+				if (obj->marked_) {
+					obj->marked_ = false;
+					obj->old_ = true;
+					++live;
+				} else {
+					obj->~Obj();
+					page->used.reset(i);
+					++collected;
+				}
+			}
+			kept += live;
+			used += &cls == &large_class ?
+				live * large_bytes(page->slot_size) : live * page->slot_size;
+			if (! live) {
+				*link = page->next;
+				delete_page(page);
+				continue;
+			}
+			if (&cls != &large_class) {
+				for (std::size_t i { 0 }; i < page->slot_count; ++i) {
+					if (page->used[i]) { continue; }
+					auto slot { reinterpret_cast<Free_Slot *>(page->slot(i)) };
+					*tail = slot;
+					tail = &slot->next;
+				}
+			}
+			link = &page->next;
+		}
+		*tail = nullptr;
+		cls.free = free;
+		cls.bump = cls.end = nullptr;
+	}
+	plan_next_collection();
+	return { collected, kept };
+}
+
+std::pair<unsigned, unsigned> Heap::sweep_young(bool marking) {
+	unsigned collected { 0 };
+	unsigned kept { 0 };
+	while (young_pages) {
+		auto page { young_pages };
+		young_pages = page->next_young;
+		for (std::size_t i { 0 }; i < page->slot_count; ++i) {
+			if (! page->used[i]) { continue; }
+			auto obj { reinterpret_cast<Obj *>(page->slot(i)) };
+			if (obj->old_) { continue; }
+			if (obj->marked_) {
+				obj->marked_ = marking || page->unswept;
+				obj->old_ = true;
+				++kept;
+			} else {
+				obj->~Obj();
+				release(obj);
+				++collected;
+			}
+		}
+		page->young = false;
+		if (page->cls == &large_class && ! page->used[0]) {
+			if (page == sweep_page) { sweep_page = page->next; }
+			unlink(page);
+			delete_page(page);
+		}
+	}
+	return { collected, kept };
+}
+
+void Heap::start_sweep() {
+	for (auto &cls : classes) {
+		for (auto page { cls.pages }; page; page = page->next) {
+			page->unswept = true;
+		}
+	}
+	sweep_class = classes;
+	sweep_page = sweep_class->pages;
+}
+
+bool Heap::sweep_some(std::size_t budget) {
+	while (sweep_class != std::end(classes)) {
+		if (! sweep_page) {
+			++sweep_class;
+			sweep_page = sweep_class != std::end(classes) ?
+				sweep_class->pages : nullptr;
+			continue;
+		}
+		if (! budget) { return false; }
+		auto page { sweep_page };
+		sweep_page = page->next;
+		// pages that were added since the start hold no garbage
+		if (! page->unswept) { continue; }
+		budget -= std::min(budget, page->slot_count);
+		page->unswept = false;
+		// releasing the object of a large page deletes the page
+		bool large { page->cls == &large_class };
+		for (std::size_t i { 0 }, count { page->slot_count }; i < count; ++i) {
+			if (! page->used[i]) { continue; }
+			auto obj { reinterpret_cast<Obj *>(page->slot(i)) };
+			if (! obj->old_) { continue; }
+			if (obj->marked_) {
+				obj->marked_ = false;
+			} else {
+				obj->~Obj();
+				release(obj);
+			}
+		}
+		if (! large && page->used.none()) { empty_pages.push_back(page); }
+	}
+	sweep_class = nullptr;
+	release_empty_pages();
+	plan_next_collection();
+	return true;
+}
+
+void Heap::start_compaction() {
+	evacuated_pages = pair_class.pages;
+	for (auto page { evacuated_pages }; page; page = page->next) {
+		page->evacuated = true;
+	}
+	pair_class = Size_Class { };
+	compacting = true;
+}
+
+bool Heap::is_evacuated(const void *ptr) {
+	return page_of(const_cast<void *>(ptr))->evacuated;
+}
+
+void Heap::end_compaction() {
+	while (evacuated_pages) {
+		auto page { evacuated_pages };
+		evacuated_pages = page->next;
+		delete_page(page);
+	}
+	new_pair_pages.clear();
+	compacting = false;
+}
+
+void Heap::foreach_new_pair(const std::function<void(Obj *)> &fn) {
+	// pages are filled one after the other, so the first unused
+	// slot ends the page
+	for (std::size_t p { 0 }; p < new_pair_pages.size(); ++p) {
+		auto page { new_pair_pages[p] };
+		for (std::size_t i { 0 }; i < page->slot_count; ++i) {
+			if (! page->used[i]) { break; }
+			fn(reinterpret_cast<Obj *>(page->slot(i)));
+		}
+	}
+}
+
+void Heap::foreach_object(const std::function<void(Obj *)> &fn) {
+	for (auto &cls : classes) {
+		if (&cls == &pair_class) { continue; }
+		for (auto page { cls.pages }; page; page = page->next) {
+			for (std::size_t i { 0 }; i < page->slot_count; ++i) {
+				if (page->used[i]) {
+					fn(reinterpret_cast<Obj *>(page->slot(i)));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,82 @@
+/**
+ * memory for Scheme objects
+ * objects are allocated from pages that hold slots of one size
+ * free slots are kept in a list per size class
+ * objects too big for a size class get a page of their own
+ * pairs live in pages of their own, so a pair is recognized
+ * by the kind of its page
+ * pages that got new objects since the last collection are
+ * the nursery, only they are swept by a minor collection
+ * pairs can be compacted: the live pairs are copied to new pages
+ * and the old pair pages are released
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+class Obj;
+
+namespace Heap {
+	constexpr std::size_t page_size { 16 * 1024 };
+
+	// every page starts with its kind
+	enum class Kind : unsigned char { objects, large, pairs };
+
+	inline Kind kind_of(const void *ptr) {
+		return *reinterpret_cast<const Kind *>(
+			reinterpret_cast<std::uintptr_t>(ptr) & ~(page_size - 1)
+		);
+	}
+
+	// bytes in use and the limits that steer the collection
+	extern std::size_t used;
+	extern std::size_t allocated;
+	extern std::size_t nursery_size;
+	extern std::size_t next_collection;
+	extern std::size_t initial_size;
+	extern std::size_t max_size;
+	extern double growth_factor;
+	extern std::size_t slice_budget;
+	extern bool compaction;
+
+	inline bool collection_due() { return allocated >= nursery_size; }
+
+	void *allocate(std::size_t size);
+	void *allocate_pair(std::size_t size);
+	void release(void *ptr);
+
+	// destroy all unmarked objects and clear the marks of the others
+	// all kept objects become old
+	// returns the number of collected and kept objects
+	// the next collection is due when the kept bytes have grown
+	// by the growth factor, but not before the initial size is used
+	std::pair<unsigned, unsigned> sweep();
+
+	// destroy the unmarked young objects, the marked ones become old
+	// while an old collection is marking, they stay marked so that it
+	// keeps them; while it sweeps, only in the pages not swept yet
+	std::pair<unsigned, unsigned> sweep_young(bool marking);
+
+	// sweep the old objects a few pages at a time
+	// returns true when all pages are swept; the pages that were left
+	// empty are released then
+	void start_sweep();
+	bool sweep_some(std::size_t budget);
+
+	// pairs allocated after start_compaction get new pages
+	// the old pair pages are evacuated and released by end_compaction
+	void start_compaction();
+	bool is_evacuated(const void *ptr);
+	void end_compaction();
+
+	// visit the pairs in the new pages in the order of allocation,
+	// including pairs that are allocated during the visit
+	void foreach_new_pair(const std::function<void(Obj *)> &fn);
+
+	// visit all objects that are not pairs
+	void foreach_object(const std::function<void(Obj *)> &fn);
+}
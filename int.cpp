@@ -93,6 +93,48 @@ std::ostream &Integer::write(std::ostream &out) {
 	return out;
 }
 
+static Integer *bignum_of(std::intptr_t value) {
+	Integer::Digits result;
+	// no overflow for the smallest value
+	auto rest { value < 0 ?
+		-static_cast<std::uintmax_t>(value) : static_cast<std::uintmax_t>(value)
+	};
+	for (; rest; rest /= 10000) {
+		result.push_back(rest % 10000);
+	}
+	if (value < 0) {
+		return new Negative_Integer { std::move(result) };
+	} else {
+		return new Integer { std::move(result) };
+	}
+}
+
+Obj *make_integer(std::intptr_t value) {
+	if (value >= fixnum_min && value <= fixnum_max) {
+		return make_fixnum(value);
+	}
+	return bignum_of(value);
+}
+
+Integer *to_bignum(Obj *num) {
+	return is_fixnum(num) ? bignum_of(fixnum_value(num)) : as_integer(num);
+}
+
+Obj *to_fixnum(Obj *num) {
+	auto i { as_integer(num) };
+	if (! i || i->digits().size() > 5) { return num; }
+	std::uintmax_t value { 0 };
+	for (auto it { i->digits().rbegin() }; it != i->digits().rend(); ++it) {
+		if (
+			__builtin_mul_overflow(value, 10000u, &value) ||
+			__builtin_add_overflow(value, *it, &value)
+		) { return num; }
+	}
+	if (value > static_cast<std::uintmax_t>(fixnum_max)) { return num; }
+	auto result { static_cast<std::intptr_t>(value) };
+	return make_fixnum(i->is_negative() ? -result : result);
+}
+
 Integer *one { nullptr };
 Integer *two { nullptr };
 Integer *zero { nullptr };
@@ -1,5 +1,8 @@
 /**
- * big integer type
+ * integer types
+ * small integers are immediates: the value is stored in the pointer,
+ * shifted by one bit and with the lowest bit set
+ * only bigger values are stored in an Integer
  */
 
 #pragma once
@@ -16,10 +19,16 @@ class Integer : public Exact_Numeric {
 		bool write_digit(unsigned digit, bool first, std::ostream &out);
 
 	public:
-		Integer(const Digits &digits): digits_ { digits } {
+		static constexpr Tag first_tag { Tag::integer };
+		static constexpr Tag last_tag { Tag::integer };
+		Integer(const Digits &digits):
+			Exact_Numeric { Tag::integer }, digits_ { digits }
+		{
 			normalize();
 		}
-		Integer(Digits &&digits): digits_ { std::move(digits) } {
+		Integer(Digits &&digits):
+			Exact_Numeric { Tag::integer }, digits_ { std::move(digits) }
+		{
 			normalize();
 		}
 		static Integer *create(const std::string &digits);
@@ -35,6 +44,28 @@ class Integer : public Exact_Numeric {
 constexpr auto as_integer = Dynamic::as<Integer>;
 constexpr auto is_integer = Dynamic::is<Integer>;
 
+constexpr std::intptr_t fixnum_max { INTPTR_MAX >> 1 };
+constexpr std::intptr_t fixnum_min { INTPTR_MIN >> 1 };
+
+inline bool is_fixnum(const Obj *obj) { return is_immediate(obj); }
+
+inline std::intptr_t fixnum_value(const Obj *obj) {
+	return reinterpret_cast<std::intptr_t>(obj) >> 1;
+}
+
+inline Obj *make_fixnum(std::intptr_t value) {
+	return reinterpret_cast<Obj *>(static_cast<std::uintptr_t>(value) << 1 | 1);
+}
+
+// a fixnum if the value fits, otherwise an Integer
+Obj *make_integer(std::intptr_t value);
+
+// the Integer of a fixnum or an Integer
+Integer *to_bignum(Obj *num);
+
+// replace an Integer by a fixnum if the value fits
+Obj *to_fixnum(Obj *num);
+
 extern Integer *one;
 extern Integer *two;
 extern Integer *zero;
@@ -0,0 +1,150 @@
+#include "native.h"
+#include "vm.h"
+#include "err.h"
+#include "primitives.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <string>
+
+// the machine executes the node like the node of a lambda
+void Native_Node::compile(Compiler &c) {
+	c.emit(Op::closure, c.constant(this));
+}
+
+std::string Native_Node::translate(Translator &) {
+	err("translate", "native code");
+	return { };
+}
+
+Obj *Native::set_global(Cell *cell, Obj *value) {
+	if (! cell->is_bound()) { err("update", "not found", cell->name()); }
+	cell->set(value);
+	return value;
+}
+
+Obj *Native::check(Obj *condition, Obj *form) {
+	if (is_false(condition)) { err("assert", "failed", form); }
+	return Symbol::get("ok");
+}
+
+Cases *Native::cases(std::initializer_list<Layout *> layouts) {
+	auto cases { new Cases { } };
+	keep(cases);
+	for (auto layout : layouts) { cases->add(layout); }
+	return cases;
+}
+
+// the values are copied to the argument stack, where they are rooted
+static Obj *apply_values(Obj *fn, std::initializer_list<Obj *> args) {
+	auto function { as_function(fn) };
+	ASSERT(function, "apply");
+	Root fn_root { fn };
+	Arguments arguments { static_cast<unsigned>(args.size()) };
+	std::copy(args.begin(), args.end(), arguments.values());
+	return function->apply_values(arguments.values(), args.size());
+}
+
+Obj *Native::call(Obj *fn, std::initializer_list<Obj *> args) {
+	if (auto proc { as_procedure(fn) }) {
+		auto layout { proc->select(args.begin(), args.size()) };
+		Local_Frames::Guard local_guard;
+		Obj *env { proc->build_env(layout, args.begin(), args.size()) };
+		Root env_root { env };
+		return run(layout->code(), as_frame(env));
+	}
+	return apply_values(fn, args);
+}
+
+Node *Native::tail_call(
+	Frame *&env, Obj *&value, Obj *fn, std::initializer_list<Obj *> args
+) {
+	return apply_step(env, value, fn, args.begin(), args.size());
+}
+
+Binary_Entry Native::binary_entry(Obj *primitive) {
+	auto fn { as_primitive(primitive) };
+	ASSERT(fn && fn->binary_entry(), "binary entry");
+	return fn->binary_entry();
+}
+
+Node *Native::tail_call_binary(
+	Frame *&env, Obj *&value, Obj *primitive, Binary_Entry entry,
+	Obj *fn, Obj *first, Obj *second
+) {
+	if (fn != primitive) { return tail_call(env, value, fn, { first, second }); }
+	value = entry(first, second);
+	return nullptr;
+}
+
+static Frame *frame(Frame *env, Layout *layout, std::initializer_list<Obj *> values) {
+	auto frame { Frame::create(env, layout) };
+	unsigned slot { 0 };
+	for (auto value : values) { frame->init(slot++, value); }
+	return frame;
+}
+
+Obj *Native::let(Frame *env, Layout *layout, std::initializer_list<Obj *> values) {
+	Local_Frames::Guard local_guard;
+	Obj *new_env { frame(env, layout, values) };
+	Root new_env_root { new_env };
+	return run(layout->code(), as_frame(new_env));
+}
+
+Node *Native::enter(Frame *&env, Layout *layout, std::initializer_list<Obj *> values) {
+	env = frame(env, layout, values);
+	return layout->code();
+}
+
+Obj *Native::list(std::initializer_list<Obj *> elements, Obj *rest) {
+	for (auto i { elements.end() }; i != elements.begin(); ) {
+		rest = cons(*--i, rest);
+	}
+	return rest;
+}
+
+namespace {
+	// the elements of a deque stay where they are when it grows
+	std::deque<Obj *> constants;
+}
+
+Obj *&Native::keep(Obj *value) {
+	constants.push_back(value);
+	return constants.back();
+}
+
+void foreach_native_root(std::function<void(Obj *&)> fn) {
+	for (auto &obj : constants) {
+		if (obj && ! is_immediate(obj)) { fn(obj); }
+	}
+}
+
+Layout *Native::layout(
+	Obj *params, Obj *body, std::initializer_list<Symbol *> names,
+	Native_Step step, bool local
+) {
+	auto layout { new Layout { params, body } };
+	keep(layout);
+	for (auto name : names) { layout->add(name); }
+	if (local) { layout->set_local(); }
+	layout->set_code(new Native_Node { step });
+	return layout;
+}
+
+int Native::main(std::initializer_list<Native_Step> forms) {
+	active_frames.clear();
+	active_frames.push_back(initial_frame);
+	for (auto step : forms) {
+		try {
+			Obj *node { new Native_Node { step } };
+			Root node_root { node };
+			std::cout << run(as_node(node), initial_frame) << '\n';
+		} catch (Error *err) {
+			if (err_stream) { *err_stream << err << '\n'; }
+			return EXIT_FAILURE;
+		}
+		Obj::compact_if_due();
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+/**
+ * support for programs that were translated to C++, see translator.h
+ * every procedure body and every top-level expression becomes a C++
+ * function that works like the step of a node: it returns the node
+ * that computes the value or sets value and returns nullptr
+ * such a function is wrapped in a Native_Node and used as the code of
+ * a Layout, so translated procedures are ordinary procedures that can
+ * be applied from interpreted code and vice versa
+ */
+
+#pragma once
+
+#include "eval.h"
+
+#include <functional>
+#include <initializer_list>
+
+using Native_Step = Node *(*)(Frame *&env, Obj *&value);
+
+class Native_Node : public Tail_Node {
+		Native_Step step_;
+	public:
+		Native_Node(Native_Step step): step_ { step } { }
+		Node *step(Frame *&env, Obj *&value) override {
+			return step_(env, value);
+		}
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+};
+
+namespace Native {
+	// access the top-level bindings like Global_Node and friends
+	inline Obj *global(Cell *cell) {
+		return cell->is_bound() ? cell->value() : cell->name();
+	}
+	Obj *set_global(Cell *cell, Obj *value);
+	inline Obj *define(Cell *cell, Obj *value) {
+		cell->set(value);
+		return value;
+	}
+	inline Obj *define(Frame *env, unsigned slot, Obj *value) {
+		env->define(slot, value);
+		return value;
+	}
+
+	Obj *check(Obj *condition, Obj *form);
+	inline Obj *closure(Frame *env, Cases *cases) {
+		return new Procedure { env, cases };
+	}
+
+	// the arguments must be rooted by the caller, if their evaluation
+	// could collect garbage
+	Obj *call(Obj *fn, std::initializer_list<Obj *> args);
+	Node *tail_call(
+		Frame *&env, Obj *&value, Obj *fn, std::initializer_list<Obj *> args
+	);
+
+	// calls of a Binary_Call_Node: entry is used if fn is still the
+	// primitive that the node was analyzed with
+	Binary_Entry binary_entry(Obj *primitive);
+	inline Obj *call_binary(
+		Obj *primitive, Binary_Entry entry, Obj *fn, Obj *first, Obj *second
+	) {
+		return fn == primitive ? entry(first, second) : call(fn, { first, second });
+	}
+	Node *tail_call_binary(
+		Frame *&env, Obj *&value, Obj *primitive, Binary_Entry entry,
+		Obj *fn, Obj *first, Obj *second
+	);
+
+	// run the code of layout in a new frame with the values in its
+	// first slots, like a Let_Node
+	Obj *let(Frame *env, Layout *layout, std::initializer_list<Obj *> values);
+	Node *enter(Frame *&env, Layout *layout, std::initializer_list<Obj *> values);
+
+	// the list of elements followed by rest
+	Obj *list(std::initializer_list<Obj *> elements, Obj *rest = nullptr);
+
+	// a root that keeps value alive until the program ends and follows
+	// it if it moves
+	Obj *&keep(Obj *value);
+
+	// local layouts were found by the analysis before the translation
+	Layout *layout(
+		Obj *params, Obj *body, std::initializer_list<Symbol *> names,
+		Native_Step step, bool local
+	);
+	Cases *cases(std::initializer_list<Layout *> layouts);
+
+	// run the top-level expressions and write their values like the
+	// interpreter does for a file
+	int main(std::initializer_list<Native_Step> forms);
+}
+
+// the constants and the primitives of the translated program
+void foreach_native_root(std::function<void(Obj *&)> fn);
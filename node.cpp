@@ -0,0 +1,98 @@
+#include "node.h"
+#include "eval.h"
+#include "err.h"
+
+Obj *Set_Global_Node::execute(Frame *env) {
+	auto value { value_->execute(env) };
+	if (! cell_->is_bound()) { err("update", "not found", cell_->name()); }
+	cell_->set(value);
+	return value;
+}
+
+Node *If_Node::step(Frame *&env, Obj *&value) {
+	return is_true(condition_->execute(env)) ? consequence_ : alternative_;
+}
+
+Node *Sequence_Node::step(Frame *&env, Obj *&value) {
+	auto last { body_.end() - 1 };
+	for (auto cur { body_.begin() }; cur != last; ++cur) {
+		(*cur)->execute(env);
+	}
+	return *last;
+}
+
+// the last test is in tail position
+Node *And_Node::step(Frame *&env, Obj *&value) {
+	if (tests_.empty()) { value = true_obj; return nullptr; }
+	auto last { tests_.end() - 1 };
+	for (auto cur { tests_.begin() }; cur != last; ++cur) {
+		value = (*cur)->execute(env);
+		if (is_false(value)) { return nullptr; }
+	}
+	return *last;
+}
+
+Node *Or_Node::step(Frame *&env, Obj *&value) {
+	if (tests_.empty()) { value = false_obj; return nullptr; }
+	auto last { tests_.end() - 1 };
+	for (auto cur { tests_.begin() }; cur != last; ++cur) {
+		value = (*cur)->execute(env);
+		if (is_true(value)) { return nullptr; }
+	}
+	return *last;
+}
+
+Obj *Lambda_Node::execute(Frame *env) {
+	return new Procedure { env, cases_ };
+}
+
+Obj *Assert_Node::execute(Frame *env) {
+	if (is_false(condition_->execute(env))) {
+		err("assert", "failed", form_);
+	}
+	return Symbol::get("ok");
+}
+
+// the frame is rooted while the values are computed
+Node *Let_Node::step(Frame *&env, Obj *&value) {
+	Obj *frame { Frame::create(env, layout_) };
+	Root frame_root { frame };
+	unsigned slot { 0 };
+	for (auto arg : args_) { as_frame(frame)->define(slot++, arg->execute(env)); }
+	env = as_frame(frame);
+	return layout_->code();
+}
+
+Binary_Call_Node::Binary_Call_Node(
+	Cell *cell, Obj *primitive, Binary_Entry entry, std::vector<Node *> &&args
+):
+	Application_Node { new Global_Node { cell }, std::move(args) },
+	cell_ { cell }, primitive_ { primitive }, entry_ { entry }
+{ }
+
+// the first value is rooted while the second is computed
+Obj *Binary_Call_Node::execute(Frame *env) {
+	if (cell_->value() != primitive_) { return Application_Node::execute(env); }
+	Obj *first { args_[0]->execute(env) };
+	Root first_root { first };
+	return entry_(first, args_[1]->execute(env));
+}
+
+Node *Binary_Call_Node::step(Frame *&env, Obj *&value) {
+	if (cell_->value() != primitive_) { return Application_Node::step(env, value); }
+	value = execute(env);
+	return nullptr;
+}
+
+// the function and the values of the arguments are evaluated into
+// the argument stack
+Node *Application_Node::step(Frame *&env, Obj *&value) {
+	auto count { static_cast<unsigned>(args_.size()) };
+	Arguments arguments { count + 1 };
+	auto values { arguments.values() };
+	values[0] = function_->execute(env);
+	for (unsigned i { 0 }; i < count; ++i) {
+		values[i + 1] = args_[i]->execute(env);
+	}
+	return apply_step(env, value, values[0], values + 1, count);
+}
@@ -0,0 +1,337 @@
+/**
+ * executable form of expressions
+ * an expression is analyzed once into a tree of nodes: special forms
+ * are recognized, derived forms are expanded and variables are
+ * resolved to a slot of a frame or to the cell of a top-level binding
+ * a node in tail position hands the node that computes its value back
+ * to the loop in run, so tail calls need no C++ stack
+ * alternatively nodes are compiled to bytecode, see vm.h, or
+ * translated to C++, see translator.h
+ */
+
+#pragma once
+
+#include "frame.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class Compiler;
+class Translator;
+
+// the function that a variadic primitive offers for calls with two
+// arguments
+using Binary_Entry = Obj *(*)(Obj *, Obj *);
+
+class Node : public Obj {
+	protected:
+		Node(): Obj { Tag::node } { }
+	public:
+		static constexpr Tag first_tag { Tag::node };
+		static constexpr Tag last_tag { Tag::node };
+
+		virtual Obj *execute(Frame *env) = 0;
+
+		// returns the node that computes the value in env or sets
+		// value and returns nullptr
+		virtual Node *step(Frame *&env, Obj *&value) {
+			value = execute(env);
+			return nullptr;
+		}
+
+		// emit code that pushes the value of the node
+		virtual void compile(Compiler &c) = 0;
+		// emit code that returns the value of the node
+		virtual void compile_tail(Compiler &c);
+
+		// C++ expression of the value of the node
+		virtual std::string translate(Translator &t) = 0;
+		// C++ statements that end a step like the step of the node
+		virtual std::string translate_tail(Translator &t);
+		// evaluating the node calls nothing and changes nothing
+		virtual bool is_simple() const { return false; }
+
+		std::ostream &write(std::ostream &out) override {
+			return out << "#node";
+		}
+};
+
+constexpr auto as_node = Dynamic::as<Node>;
+
+// execute node and all nodes that it hands over
+Obj *run(Node *node, Frame *env);
+
+class Constant_Node : public Node {
+		Obj *value_;
+	protected:
+		void propagate_mark() override { mark(value_); }
+		void forward_references() override { forward(value_); }
+	public:
+		Constant_Node(Obj *value): value_ { value } { }
+		Obj *execute(Frame *) override { return value_; }
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		bool is_simple() const override { return true; }
+};
+
+class Local_Node : public Node {
+		unsigned depth_;
+		unsigned slot_;
+		Symbol *name_;
+	public:
+		Local_Node(unsigned depth, unsigned slot, Symbol *name):
+			depth_ { depth }, slot_ { slot }, name_ { name } { }
+		Obj *execute(Frame *env) override {
+			return env->get(depth_, slot_, name_);
+		}
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		bool is_simple() const override { return true; }
+};
+
+// unbound top-level variables evaluate to their symbol
+class Global_Node : public Node {
+		Cell *cell_;
+	protected:
+		void propagate_mark() override { mark(cell_); }
+	public:
+		Global_Node(Cell *cell): cell_ { cell } { }
+		Obj *execute(Frame *) override {
+			return cell_->is_bound() ? cell_->value() : cell_->name();
+		}
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		bool is_simple() const override { return true; }
+};
+
+class Set_Local_Node : public Node {
+		unsigned depth_;
+		unsigned slot_;
+		Symbol *name_;
+		Node *value_;
+	protected:
+		void propagate_mark() override { mark(value_); }
+	public:
+		Set_Local_Node(unsigned depth, unsigned slot, Symbol *name, Node *value):
+			depth_ { depth }, slot_ { slot }, name_ { name },
+			value_ { value } { }
+		Obj *execute(Frame *env) override {
+			return env->update(depth_, slot_, name_, value_->execute(env));
+		}
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+};
+
+class Set_Global_Node : public Node {
+		Cell *cell_;
+		Node *value_;
+	protected:
+		void propagate_mark() override { mark(cell_); mark(value_); }
+	public:
+		Set_Global_Node(Cell *cell, Node *value):
+			cell_ { cell }, value_ { value } { }
+		Obj *execute(Frame *env) override;
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+};
+
+class Define_Local_Node : public Node {
+		unsigned slot_;
+		Node *value_;
+	protected:
+		void propagate_mark() override { mark(value_); }
+	public:
+		Define_Local_Node(unsigned slot, Node *value):
+			slot_ { slot }, value_ { value } { }
+		Obj *execute(Frame *env) override {
+			auto value { value_->execute(env) };
+			env->define(slot_, value);
+			return value;
+		}
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+};
+
+class Define_Global_Node : public Node {
+		Cell *cell_;
+		Node *value_;
+	protected:
+		void propagate_mark() override { mark(cell_); mark(value_); }
+	public:
+		Define_Global_Node(Cell *cell, Node *value):
+			cell_ { cell }, value_ { value } { }
+		Obj *execute(Frame *env) override {
+			auto value { value_->execute(env) };
+			cell_->set(value);
+			return value;
+		}
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+};
+
+// nodes that may hand over a node are executed by run
+class Tail_Node : public Node {
+	public:
+		Obj *execute(Frame *env) override { return run(this, env); }
+		Node *step(Frame *&env, Obj *&value) override = 0;
+};
+
+class If_Node : public Tail_Node {
+		Node *condition_;
+		Node *consequence_;
+		Node *alternative_;
+	protected:
+		void propagate_mark() override {
+			mark(condition_); mark(consequence_); mark(alternative_);
+		}
+	public:
+		If_Node(Node *condition, Node *consequence, Node *alternative):
+			condition_ { condition }, consequence_ { consequence },
+			alternative_ { alternative } { }
+		Node *step(Frame *&env, Obj *&value) override;
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		void compile_tail(Compiler &c) override;
+		std::string translate_tail(Translator &t) override;
+};
+
+class Sequence_Node : public Tail_Node {
+		std::vector<Node *> body_;
+	protected:
+		void propagate_mark() override {
+			for (auto node : body_) { mark(node); }
+		}
+	public:
+		Sequence_Node(std::vector<Node *> &&body): body_ { std::move(body) } { }
+		Node *step(Frame *&env, Obj *&value) override;
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		void compile_tail(Compiler &c) override;
+		std::string translate_tail(Translator &t) override;
+};
+
+class And_Node : public Tail_Node {
+		std::vector<Node *> tests_;
+	protected:
+		void propagate_mark() override {
+			for (auto node : tests_) { mark(node); }
+		}
+	public:
+		And_Node(std::vector<Node *> &&tests): tests_ { std::move(tests) } { }
+		Node *step(Frame *&env, Obj *&value) override;
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		void compile_tail(Compiler &c) override;
+		std::string translate_tail(Translator &t) override;
+};
+
+class Or_Node : public Tail_Node {
+		std::vector<Node *> tests_;
+	protected:
+		void propagate_mark() override {
+			for (auto node : tests_) { mark(node); }
+		}
+	public:
+		Or_Node(std::vector<Node *> &&tests): tests_ { std::move(tests) } { }
+		Node *step(Frame *&env, Obj *&value) override;
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		void compile_tail(Compiler &c) override;
+		std::string translate_tail(Translator &t) override;
+};
+
+// creates a procedure with a case for each layout
+class Lambda_Node : public Node {
+		Cases *cases_ { new Cases { } };
+	protected:
+		void propagate_mark() override { mark(cases_); }
+	public:
+		void add_case(Layout *layout) { cases_->add(layout); }
+		Obj *execute(Frame *env) override;
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		bool is_simple() const override { return true; }
+};
+
+class Assert_Node : public Node {
+		Node *condition_;
+		Obj *form_;
+	protected:
+		void propagate_mark() override { mark(condition_); mark(form_); }
+		void forward_references() override { forward(form_); }
+	public:
+		Assert_Node(Node *condition, Obj *form):
+			condition_ { condition }, form_ { form } { }
+		Obj *execute(Frame *env) override;
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+};
+
+// continues with the code of layout in a new frame whose first slots
+// hold the values of args; a let needs no procedure
+class Let_Node : public Tail_Node {
+		Layout *layout_;
+		std::vector<Node *> args_;
+	protected:
+		void propagate_mark() override {
+			mark(layout_);
+			for (auto node : args_) { mark(node); }
+		}
+	public:
+		Let_Node(Layout *layout, std::vector<Node *> &&args):
+			layout_ { layout }, args_ { std::move(args) } { }
+		Node *step(Frame *&env, Obj *&value) override;
+		void compile(Compiler &c) override;
+		void compile_tail(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		std::string translate_tail(Translator &t) override;
+};
+
+// a call of a procedure continues with its body in the new frame
+class Application_Node : public Tail_Node {
+	protected:
+		Node *function_;
+		std::vector<Node *> args_;
+		void propagate_mark() override {
+			mark(function_);
+			for (auto node : args_) { mark(node); }
+		}
+	public:
+		Application_Node(Node *function, std::vector<Node *> &&args):
+			function_ { function }, args_ { std::move(args) } { }
+		Node *step(Frame *&env, Obj *&value) override;
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		void compile_tail(Compiler &c) override;
+		std::string translate_tail(Translator &t) override;
+};
+
+// a call with two arguments of a top-level variable that held a
+// variadic primitive during the analysis; while the variable still
+// holds it, its binary entry is called directly, otherwise the call
+// is an ordinary application
+class Binary_Call_Node : public Application_Node {
+		Cell *cell_;
+		Obj *primitive_;
+		Binary_Entry entry_;
+	protected:
+		void propagate_mark() override {
+			Application_Node::propagate_mark();
+			mark(cell_);
+			mark(primitive_);
+		}
+	public:
+		Binary_Call_Node(
+			Cell *cell, Obj *primitive, Binary_Entry entry,
+			std::vector<Node *> &&args
+		);
+		Obj *primitive() const { return primitive_; }
+		Binary_Entry entry() const { return entry_; }
+		Obj *execute(Frame *env) override;
+		Node *step(Frame *&env, Obj *&value) override;
+		void compile(Compiler &c) override;
+		std::string translate(Translator &t) override;
+		void compile_tail(Compiler &c) override;
+		std::string translate_tail(Translator &t) override;
+};
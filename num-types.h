@@ -6,21 +6,40 @@
 
 #include "dynamic.h"
 
-class Numeric : public Obj { };
+class Numeric : public Obj {
+	protected:
+		Numeric(Tag tag): Obj { tag } { }
+	public:
+		static constexpr Tag first_tag { Tag::integer };
+		static constexpr Tag last_tag { Tag::float_number };
+};
 
 constexpr auto is_numeric = Dynamic::is<Numeric>;
 
-class Exact_Numeric : public Numeric { };
+class Exact_Numeric : public Numeric {
+	protected:
+		Exact_Numeric(Tag tag): Numeric { tag } { }
+	public:
+		static constexpr Tag first_tag { Tag::integer };
+		static constexpr Tag last_tag { Tag::exact_complex };
+};
 
 constexpr auto is_exact = Dynamic::is<Exact_Numeric>;
 
-class Inexact_Numeric : public Numeric { };
+class Inexact_Numeric : public Numeric {
+	protected:
+		Inexact_Numeric(Tag tag): Numeric { tag } { }
+	public:
+		static constexpr Tag first_tag { Tag::inexact_complex };
+		static constexpr Tag last_tag { Tag::float_number };
+};
 
 constexpr auto is_inexact = Dynamic::is<Inexact_Numeric>;
 
 struct Complex_Numeric {
+	static constexpr Tag first_tag { Tag::exact_complex };
+	static constexpr Tag last_tag { Tag::inexact_complex };
 	virtual ~Complex_Numeric() { }
 };
 
 constexpr auto is_complex = Dynamic::is<Complex_Numeric>;
-
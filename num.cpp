@@ -3,6 +3,7 @@
  */
 
 #include "num.h"
+#include "types.h"
 #include "parser.h"
 #include "err.h"
 
@@ -24,7 +25,7 @@ static Obj *create_uncomplex(const std::string &value) {
 	} else if (is_real(value)) {
 		return new Float(float_value(value));
 	} else {
-		return Integer::create(value);
+		return to_fixnum(Integer::create(value));
 	}
 }
 
@@ -125,6 +126,7 @@ template<typename R> class Single_Propagate {
 		virtual R apply_else(Obj *a) = 0;
 	public:
 		R propagate(Obj *a) {
+			if (is_fixnum(a)) { a = to_bignum(a); }
 			if (auto ai { as_integer(a) }) {
 			       	return apply_int(ai);
 		       	}
@@ -146,7 +148,7 @@ template<typename R> class Single_Propagate {
 
 class Negate_Propagate : public Single_Propagate<Obj *> {
 	protected:
-		Obj *apply_int(Integer *a) override { return a->negate(); }
+		Obj *apply_int(Integer *a) override { return to_fixnum(a->negate()); }
 		Obj *apply_fract(Fraction *a) override { return a->negate(); }
 		Obj *apply_real(Float *a) override { return new Float { - a->value() }; }
 		Obj *apply_exact_complex(Exact_Complex *a) override { return a->negate(); }
@@ -154,7 +156,10 @@ class Negate_Propagate : public Single_Propagate<Obj *> {
 		Obj *apply_else(Obj *a) { err("negate", "else", a); return nullptr; }
 };
 
-Obj *negate(Obj *a) { return Negate_Propagate{}.propagate(a); }
+Obj *negate(Obj *a) {
+	if (is_fixnum(a)) { return make_integer(-fixnum_value(a)); }
+	return Negate_Propagate{}.propagate(a);
+}
 
 class Single_Bool_Propagate : public Single_Propagate<bool> {
 	protected:
@@ -180,7 +185,10 @@ class Is_Negative_Propagate : public Single_Bool_Propagate {
 	       	}
 };
 
-bool is_negative(Obj *a) { return Is_Negative_Propagate{}.propagate(a); }
+bool is_negative(Obj *a) {
+	if (is_fixnum(a)) { return fixnum_value(a) < 0; }
+	return Is_Negative_Propagate{}.propagate(a);
+}
 
 class Is_Zero_Propagate : public Single_Bool_Propagate {
 	protected:
@@ -192,7 +200,10 @@ class Is_Zero_Propagate : public Single_Bool_Propagate {
 		bool apply_inexact_complex(Inexact_Complex *a) override { return a->value() == 0.0; }
 };
 
-bool is_zero(Obj *a) { return Is_Zero_Propagate{}.propagate(a); }
+bool is_zero(Obj *a) {
+	if (is_fixnum(a)) { return fixnum_value(a) == 0; }
+	return Is_Zero_Propagate{}.propagate(a);
+}
 
 class Propagate {
 	protected:
@@ -206,9 +217,11 @@ class Propagate {
 };
 
 Obj *Propagate::propagate(Obj *a, Obj *b) {
+	if (is_fixnum(a)) { a = to_bignum(a); }
+	if (is_fixnum(b)) { b = to_bignum(b); }
 	auto ai { as_integer(a) };
 	auto bi { as_integer(b) };
-	if (ai && bi) { return apply_int(ai, bi); }
+	if (ai && bi) { return to_fixnum(apply_int(ai, bi)); }
 	auto afr { as_fraction(a) };
 	auto bfr { as_fraction(b) };
 	if (afr || bfr) {
@@ -285,6 +298,9 @@ class Add_Propagate : public Propagate {
 };
 
 Obj *add(Obj *a, Obj *b) {
+	if (is_fixnum(a) && is_fixnum(b)) {
+		return make_integer(fixnum_value(a) + fixnum_value(b));
+	}
 	auto a_neg { is_negative(a) };
 	auto b_neg { is_negative(b) };
 	if (! a_neg && b_neg) {
@@ -323,6 +339,9 @@ class Sub_Propagate : public Propagate {
 };
 
 Obj *sub(Obj *a, Obj *b) {
+	if (is_fixnum(a) && is_fixnum(b)) {
+		return make_integer(fixnum_value(a) - fixnum_value(b));
+	}
 	auto a_neg { is_negative(a) };
 	auto b_neg { is_negative(b) };
 	if (! a_neg && b_neg) {
@@ -363,6 +382,14 @@ class Mul_Propagate : public Propagate {
 };
 
 Obj *mult(Obj *a, Obj *b) {
+	std::intptr_t product;
+	if (
+		is_fixnum(a) && is_fixnum(b) && ! __builtin_mul_overflow(
+			fixnum_value(a), fixnum_value(b), &product
+		)
+	) {
+		return make_integer(product);
+	}
 	auto a_neg { is_negative(a) };
 	auto b_neg { is_negative(b) };
 	if (a_neg && b_neg) {
@@ -404,7 +431,13 @@ class Div_Propagate : public Propagate {
 };
 
 Obj *div(Obj *a, Obj *b) {
-	if (is_zero(a)) { return zero; }
+	if (
+		is_fixnum(a) && is_fixnum(b) && fixnum_value(b) &&
+		fixnum_value(a) % fixnum_value(b) == 0
+	) {
+		return make_integer(fixnum_value(a) / fixnum_value(b));
+	}
+	if (is_zero(a)) { return make_fixnum(0); }
 	auto a_neg { is_negative(a) };
 	auto b_neg { is_negative(b) };
 	if (a_neg && b_neg) {
@@ -442,6 +475,9 @@ class Less_Propagate : public Propagate {
 };
 
 Obj *less(Obj *a, Obj *b) {
+	if (is_fixnum(a) && is_fixnum(b)) {
+		return to_bool(fixnum_value(a) < fixnum_value(b));
+	}
 	auto a_neg { is_negative(a) };
 	auto b_neg { is_negative(b) };
 	if (a_neg && b_neg) {
@@ -480,6 +516,7 @@ class Equal_Propagate : public Propagate {
 };
 
 Obj *is_equal_num(Obj *a, Obj *b) {
+	if (is_fixnum(a) && is_fixnum(b)) { return to_bool(a == b); }
 	if (is_zero(a) && is_zero(b)) { return to_bool(true); }
 	if (is_negative(a) != is_negative(b)) { return to_bool(false); }
 
@@ -513,8 +550,8 @@ Obj *Fraction::create(Obj *num, Obj *denom) {
 		return ::negate(create(::negate(num), denom));
 	}
 
-	auto ni { as_integer(num) };
-	auto di { as_integer(denom) };
+	auto ni { to_bignum(num) };
+	auto di { to_bignum(denom) };
 	ASSERT(ni && di, "fraction");
 	auto g { as_integer(gcd(ni, di)) };
 	if (g && is_false(is_equal_num(g, one))) {
@@ -523,7 +560,7 @@ Obj *Fraction::create(Obj *num, Obj *denom) {
 		ASSERT(ni && di, "fraction");
 	}
 	if (is_true(is_equal_num(one, di))) {
-		return ni;
+		return to_fixnum(ni);
 	}
 	return new Fraction { ni, di };
 }
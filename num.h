@@ -8,7 +8,7 @@
 #include "value.h"
 #include "int.h"
 
-using Float = Value_Element<double, Inexact_Numeric>;
+using Float = Value_Element<double, Inexact_Numeric, Tag::float_number>;
 
 constexpr auto as_float = Dynamic::as<Float>;
 constexpr auto is_float = Dynamic::is<Float>;
@@ -16,9 +16,14 @@ constexpr auto is_float = Dynamic::is<Float>;
 class Fraction : public Exact_Numeric {
 		Integer *num_;
 		Integer *denom_;
-		Fraction(Integer *num, Integer *denom): num_ { num }, denom_ { denom } { }
+		Fraction(Integer *num, Integer *denom):
+			Exact_Numeric { Tag::fraction }, num_ { num }, denom_ { denom } { }
+	protected:
+		void propagate_mark() override { mark(num_); mark(denom_); }
 
 	public:
+		static constexpr Tag first_tag { Tag::fraction };
+		static constexpr Tag last_tag { Tag::fraction };
 		static Fraction *create_forced(Integer *num, Integer *denom);
 		static Obj *create(Obj *num, Obj *denom);
 		static Obj *create(const std::string &value);
@@ -38,8 +43,13 @@ bool is_negative(Obj *a);
 class Exact_Complex : public Exact_Numeric, public Complex_Numeric {
 		Obj *real_;
 		Obj *imag_;
-		Exact_Complex(Obj *real, Obj *imag): real_ { real }, imag_ { imag } { }
+		Exact_Complex(Obj *real, Obj *imag):
+			Exact_Numeric { Tag::exact_complex }, real_ { real }, imag_ { imag } { }
+	protected:
+		void propagate_mark() override { mark(real_); mark(imag_); }
 	public:
+		static constexpr Tag first_tag { Tag::exact_complex };
+		static constexpr Tag last_tag { Tag::exact_complex };
 		static Obj *create(Obj *real, Obj *imag);
 		static Obj *create(const std::string &value);
 		static Exact_Complex *create_forced(Obj *real, Obj *imag);
@@ -57,8 +67,11 @@ constexpr auto is_exact_complex = Dynamic::is<Exact_Complex>;
 class Inexact_Complex : public Inexact_Numeric, public Complex_Numeric {
 		using num_type = std::complex<double>;
 		num_type value_;
-		Inexact_Complex(const num_type &value): value_ { value } { }
+		Inexact_Complex(const num_type &value):
+			Inexact_Numeric { Tag::inexact_complex }, value_ { value } { }
 	public:
+		static constexpr Tag first_tag { Tag::inexact_complex };
+		static constexpr Tag last_tag { Tag::inexact_complex };
 		static Obj *create(const num_type &value);
 		static Obj *create(const std::string &value);
 		static Inexact_Complex *create_forced(const num_type &value);
@@ -78,10 +91,6 @@ Obj *mult(Obj *a, Obj *b);
 Obj *sub(Obj *a, Obj *b);
 Obj *div(Obj *a, Obj *b);
 
-Obj *to_bool(bool cond);
-bool is_true(Obj *value);
-bool is_false(Obj *value);
-
 Obj *less(Obj *a, Obj *b);
 
 Obj *is_equal_num(Obj *a, Obj *b);
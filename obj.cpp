@@ -1,39 +1,167 @@
 #include "obj.h"
 #include "eval.h"
+#include "syntax.h"
+#include "vm.h"
+#include "native.h"
 #include "int.h"
+#include "err.h"
 
-Obj::Mark_Container Obj::a_marked_;
-Obj::Mark_Container Obj::b_marked_;
-Obj::Mark_Container *Obj::current_marked_ { &a_marked_ };
-Obj::Mark_Container *Obj::other_marked_ { &b_marked_ };
-
-std::vector<Obj *> Obj::active_elements;
+std::vector<Obj **> Obj::roots_;
+std::vector<Obj *> Obj::remembered_set_;
+std::vector<Obj *> Obj::gray_;
+Obj::State Obj::state_ { Obj::State::idle };
+bool Obj::minor_ { false };
+bool Obj::compaction_due_ { false };
 
 std::ostream &operator<<(std::ostream &out, Obj *elm) {
-	if (elm) {
+	if (is_fixnum(elm)) {
+		return out << fixnum_value(elm);
+	} else if (elm) {
 		return elm->write(out);
 	} else {
 		return out << "()";
 	}
 }
 
-std::pair<unsigned, unsigned> Obj::garbage_collect() {
-	std::swap(Obj::current_marked_, Obj::other_marked_);
-	
+void Obj::mark_roots() {
+	Symbol::foreach([](Symbol *sym){ sym->mark(); });
 	foreach_syntax_extension([](Obj *obj){ obj->mark(); });
+	foreach_vm_root([](Obj *obj){ obj->mark(); });
+	foreach_native_root([](Obj *&obj){ obj->mark(); });
+	Arguments::foreach([](Obj *obj){ obj->mark(); });
 	for (auto &f : active_frames) { f->mark(); }
-	for (auto &e : active_elements) { e->mark(); }
+	Local_Frames::foreach([](Obj *frame){ frame->propagate_mark(); });
+	for (auto slot : roots_) {
+		if (*slot && ! is_immediate(*slot)) { (*slot)->mark(); }
+	}
 	one->mark(); zero->mark(); two->mark();
 	false_obj->mark(); true_obj->mark();
+	Frame::unbound->mark();
+}
 
-	unsigned kept = current_marked_->size();
-	unsigned collected = other_marked_->size();
-	std::vector<Obj *> to_delete;
-	for (auto obj : *other_marked_) {
-		to_delete.push_back(obj);
+bool Obj::mark_some(std::size_t budget) {
+	for (; budget && ! gray_.empty(); --budget) {
+		auto obj { gray_.back() };
+		gray_.pop_back();
+		if (! gray_.empty()) { __builtin_prefetch(gray_.back()); }
+		obj->propagate_mark();
 	}
-	other_marked_->clear();
-	for (auto obj : to_delete) { delete obj; }
+	return gray_.empty();
+}
+
+void Obj::forget_remembered() {
+	for (auto obj : remembered_set_) { obj->remembered_ = false; }
+	remembered_set_.clear();
+}
+
+void Obj::end_marking() {
+	// remembered objects that were not marked will be swept
+	remembered_set_.erase(std::remove_if(
+		remembered_set_.begin(), remembered_set_.end(),
+		[](Obj *obj) { return ! obj->marked_; }
+	), remembered_set_.end());
+	state_ = State::sweeping;
+	Heap::start_sweep();
+}
+
+void Obj::finish_cycle() {
+	if (state_ == State::marking) {
+		mark_some(-1);
+		end_marking();
+	}
+	if (state_ == State::sweeping) {
+		Heap::sweep_some(-1);
+		state_ = State::idle;
+	}
+}
 
-	return { collected, kept };
+std::pair<unsigned, unsigned> Obj::garbage_collect() {
+	finish_cycle();
+	collect_young();
+	mark_roots();
+	mark_some(-1);
+	return Heap::sweep();
+}
+
+// copy a list to the new pair pages, following its rest chain
+// so that the cells end up next to each other
+// the old cell loses its mark and keeps its copy in its head
+Obj *Obj::relocate(Obj *obj) {
+	if (! is_pair(obj) || ! Heap::is_evacuated(obj)) { return obj; }
+	if (! obj->marked_) { return as_pair(obj)->head(); }
+	Pair *first { nullptr };
+	Pair *last { nullptr };
+	while (is_pair(obj) && Heap::is_evacuated(obj) && obj->marked_) {
+		auto cell { as_pair(obj) };
+		auto copy { new Pair { cell->head(), nullptr } };
+		copy->marked_ = copy->old_ = true;
+		if (last) { last->set_rest(copy); } else { first = copy; }
+		last = copy;
+		obj = cell->rest();
+		cell->marked_ = false;
+		cell->set_head(copy);
+	}
+	last->set_rest(relocate(obj));
+	return first;
+}
+
+std::pair<unsigned, unsigned> Obj::compact() {
+	finish_cycle();
+	collect_young();
+	mark_roots();
+	mark_some(-1);
+	Heap::start_compaction();
+	Heap::foreach_object([](Obj *obj) {
+		if (obj->marked_) { obj->forward_references(); }
+	});
+	Heap::foreach_new_pair([](Obj *obj) { obj->forward_references(); });
+	Local_Frames::foreach([](Obj *frame) { frame->forward_references(); });
+	foreach_native_root([](Obj *&obj) { forward(obj); });
+	Heap::end_compaction();
+	compaction_due_ = false;
+	return Heap::sweep();
+}
+
+// may run while an old collection is marking: its gray objects wait
+std::pair<unsigned, unsigned> Obj::collect_young() {
+	std::vector<Obj *> old_gray;
+	old_gray.swap(gray_);
+	minor_ = true;
+	mark_roots();
+	for (auto obj : remembered_set_) { obj->propagate_mark(); }
+	forget_remembered();
+	mark_some(-1);
+	minor_ = false;
+	gray_.swap(old_gray);
+	return Heap::sweep_young(state_ == State::marking);
+}
+
+void Obj::collect() {
+	switch (state_) {
+		case State::idle:
+			collect_young();
+			if (Heap::used >= Heap::next_collection) {
+				state_ = State::marking;
+				mark_roots();
+			}
+			break;
+		case State::marking:
+			collect_young();
+			if (mark_some(Heap::slice_budget)) { end_marking(); }
+			break;
+		case State::sweeping:
+			collect_young();
+			if (Heap::sweep_some(Heap::slice_budget)) {
+				state_ = State::idle;
+				compaction_due_ = Heap::compaction;
+			}
+			break;
+	}
+	Heap::allocated = 0;
+	if (Heap::max_size && Heap::used > Heap::max_size) {
+		garbage_collect();
+		if (Heap::used > Heap::max_size) {
+			err("garbage-collect", "heap limit exceeded");
+		}
+	}
 }
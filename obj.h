@@ -1,62 +1,163 @@
 /**
  * define base element for all Scheme-related types
  * it can be written to an output stream
- * and it is kept in a list to be garbage collected
- * the lowest bit for the link-field is used as mark
- * for the garbage collection algorithm
+ * and it is allocated on the heap to be garbage collected
+ * the header holds the mark for the garbage collection algorithm
+ * objects that survived a collection are old; a minor collection
+ * only looks at the young objects and at the old objects that were
+ * changed to point to young ones (the remembered set)
+ * old objects are collected incrementally: marking and sweeping are
+ * done in slices between evaluation steps, and each slice still
+ * starts with a minor collection
+ * optionally pairs are moved after an old collection so that lists
+ * become contiguous; this is only done between top-level expressions,
+ * where no object is referenced from the C++ stack
  */
 
 #pragma once
 
+#include "heap.h"
+
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <set>
+
+class Root;
+class Obj;
+
+// pointers with the lowest bit set are no objects but immediate
+// values, see int.h
+inline bool is_immediate(const Obj *obj) {
+	return reinterpret_cast<std::uintptr_t>(obj) & 1;
+}
+
+// the type of an object is stored in its header
+// types with subtypes cover a range of tags
+enum class Tag : unsigned char {
+	other, symbol, pair, frame, layout, cell, node, code, string, primitive, procedure,
+	integer, fraction, exact_complex, inexact_complex, float_number
+};
 
 class Obj {
-		using Mark_Container = std::set<Obj *>;
-		static Mark_Container a_marked_;
-		static Mark_Container b_marked_;
-		static Mark_Container *current_marked_;
-		static Mark_Container *other_marked_;
+		friend class Root;
+		friend std::pair<unsigned, unsigned> Heap::sweep();
+		friend std::pair<unsigned, unsigned> Heap::sweep_young(bool marking);
+		friend bool Heap::sweep_some(std::size_t budget);
 
-		static std::vector<Obj *> active_elements;
+		bool marked_ { false };
+		bool old_ { false };
+		bool remembered_ { false };
+		const Tag tag_;
 
-		bool has_current_mark() {
-			return current_marked_->find(this) !=
-			       	current_marked_->end();
-		}
+		static std::vector<Obj **> roots_;
+		static std::vector<Obj *> remembered_set_;
+		static std::vector<Obj *> gray_;
 
+		enum class State { idle, marking, sweeping };
+		static State state_;
+		static bool minor_;
+		static bool compaction_due_;
+
+		// only the generation that is collected gets marked
+		// marked objects are gray until their references are marked
 		void mark() {
-			if (! has_current_mark()) {
-				other_marked_->erase(this);
-				current_marked_->insert(this);
-				propagate_mark();
+			if (! marked_ && old_ != minor_) {
+				marked_ = true;
+				gray_.push_back(this);
 			}
 		}
 
+		static void mark_roots();
+		static bool mark_some(std::size_t budget);
+		static void forget_remembered();
+		static void end_marking();
+		static void finish_cycle();
+		static Obj *relocate(Obj *obj);
+
 	protected:
+		Obj(Tag tag = Tag::other): tag_ { tag } { }
+
 		virtual void propagate_mark() { }
 			
-		void mark(Obj *elm) { if (elm) { elm->mark(); } }
+		void mark(Obj *elm) {
+			if (elm && ! is_immediate(elm)) { elm->mark(); }
+		}
+
+		// mark elm without putting it onto the gray stack
+		// returns false if it needs no marking; otherwise the caller
+		// must propagate the mark itself
+		static bool claim(Obj *elm) {
+			if (elm->marked_ || elm->old_ == minor_) { return false; }
+			elm->marked_ = true;
+			return true;
+		}
+
+		// objects outside of the heap keep their mark for good, so
+		// they are never traced; the collector reaches their
+		// references through the roots
+		void pin_mark() { marked_ = true; }
+
+		// replace all references to pairs by their new address
+		virtual void forward_references() { }
+		static void forward(Obj *&elm) { elm = relocate(elm); }
+
+		// must be called whenever a reference in an existing object
+		// is replaced; while marking, the old value is kept alive
+		// so that everything reachable at the start is marked
+		void write_barrier(Obj *old_value, Obj *value) {
+			if (state_ == State::marking) { mark(old_value); }
+			if (
+				old_ && ! remembered_ && value &&
+				! is_immediate(value) && ! value->old_
+			) {
+				remembered_ = true;
+				remembered_set_.push_back(this);
+			}
+		}
 
 	public:
-		Obj() { current_marked_->insert(this); }
-		virtual ~Obj() {
-			current_marked_->erase(this);
-			other_marked_->erase(this);
+		virtual ~Obj() { }
+		Tag tag() const { return tag_; }
+
+		static void *operator new(std::size_t size) {
+			return Heap::allocate(size);
 		}
+		static void operator delete(void *ptr) { Heap::release(ptr); }
 
 		virtual std::ostream &write(std::ostream &out) = 0;
 		static std::pair<unsigned, unsigned> garbage_collect();
+		static std::pair<unsigned, unsigned> collect_young();
+		static std::pair<unsigned, unsigned> compact();
 
-		void make_active() { active_elements.push_back(this); }
-		void cease_active() {
-			active_elements.erase(find(
-				active_elements.begin(),
-				active_elements.end(), this
-			));
+		// must only be called if no object is referenced from the
+		// C++ stack
+		static void compact_if_due() {
+			if (compaction_due_ && roots_.empty()) { compact(); }
 		}
+
+		// called at points where all live objects are reachable
+		// from the roots; raises an error if the heap stays too big
+		static void collect_if_due() {
+			if (Heap::collection_due()) { collect(); }
+		}
+	private:
+		static void collect();
+};
+
+// keeps the object in a C++ variable alive while the variable is in
+// scope; roots are pushed and popped in LIFO order
+class Root {
+	public:
+		Root(Obj *&slot) { Obj::roots_.push_back(&slot); }
+		~Root() { Obj::roots_.pop_back(); }
+		Root(const Root &) = delete;
+		Root &operator=(const Root &) = delete;
 };
 
+// immediates are integers
+inline Tag tag_of(const Obj *obj) {
+	return is_immediate(obj) ? Tag::integer : obj->tag();
+}
+
 std::ostream &operator<<(std::ostream &out, Obj *elm);
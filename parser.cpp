@@ -3,6 +3,7 @@
 #include "string.h"
 #include "err.h"
 #include "num.h"
+#include "stack.h"
 
 static int ch { ' ' };
 static bool last_is_hash { false };
@@ -54,29 +55,39 @@ static void eat_space(std::istream &in) {
 	}
 }
 
+// the elements are appended in a loop, only nested lists recurse
 static Obj *read_list(std::istream &in, int closing) {
-	eat_space(in);
-	if (ch == EOF) {
-		err("read_list", "incomplete_list");
-	}
-	if (ch == closing) {
-		get(in);
-		return nullptr;
-	}
-	if (ch == ')' || ch == ']') {
-		err("read_list", "unmatched closing");
-	}
-
-	auto exp { read_expression(in) };
-	auto sym { as_symbol(exp) };
-	if (sym && sym->value() == ".") {
-		auto result { read_expression(in) };
+	Obj *result { nullptr };
+	Pair *last { nullptr };
+	for (;;) {
 		eat_space(in);
-		ASSERT(ch == closing, "read_list");
-		get(in);
+		if (ch == EOF) {
+			err("read_list", "incomplete_list");
+		}
+		Obj *rest { nullptr };
+		if (ch == closing) {
+			get(in);
+		} else {
+			if (ch == ')' || ch == ']') {
+				err("read_list", "unmatched closing");
+			}
+
+			auto exp { read_expression(in) };
+			auto sym { as_symbol(exp) };
+			if (! sym || sym->value() != ".") {
+				auto cell { new Pair { exp, nullptr } };
+				if (last) { last->set_rest(cell); } else { result = cell; }
+				last = cell;
+				continue;
+			}
+			rest = read_expression(in);
+			eat_space(in);
+			ASSERT(ch == closing, "read_list");
+			get(in);
+		}
+		if (last) { last->set_rest(rest); } else { result = rest; }
 		return result;
 	}
-	return cons(exp, read_list(in, closing));
 }
 
 double float_value(const std::string &v) {
@@ -157,7 +168,7 @@ static inline Obj *create_number(const std::string &value) {
 		}
 	} else {
 		if (digits && fraction && ! dots) { return Fraction::create(value); }
-		if (digits && ! dots) { return Integer::create(value); }
+		if (digits && ! dots) { return to_fixnum(Integer::create(value)); }
 		if (digits && dots) {
 			return new Float { float_value(value) };
 		}
@@ -170,12 +181,16 @@ static int skip_expressions { 0 };
 Obj *parse_expression(std::istream &in) {
 	eat_space(in);
 	if (ch == EOF) { return nullptr; }
+	if (Stack::is_low()) {
+		return Stack::extend([&]() { return parse_expression(in); });
+	}
+	Stack::Depth_Guard depth_guard;
 	if (ch == '(') { get(in); return read_list(in, ')'); }
 	if (ch == '[') { get(in); return read_list(in, ']'); }
 	if (ch == ')' || ch == ']') { get(in); return nullptr; }
 	if (ch == '\'') {
 		ch = get(in);
-		return build_list(Symbol::get("quote"), read_expression(in));
+		return build_list(Symbol::get(Special::quote), read_expression(in));
 	}
 	if (ch == '"') {
 		std::ostringstream result;
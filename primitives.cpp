@@ -18,12 +18,16 @@ class One_Primitive : public Primitive {
 			ASSERT(is_null(cdr(args)), "one primitive");
 			return apply_one(car(args));
 		}
+		Obj *apply_values(Obj *const *values, unsigned count) override {
+			ASSERT(count == 1, "one primitive");
+			return apply_one(values[0]);
+		}
 };
 
 class To_Float: public One_Primitive {
 	protected:
 		Obj *apply_one(Obj *arg) override {
-			auto i { as_integer(arg) };
+			auto i { to_bignum(arg) };
 			return i ? new Float { i->float_value() } : arg;
 		}
 };
@@ -55,6 +59,10 @@ class Two_Primitive : public Primitive {
 			ASSERT(is_null(cdr(nxt)), "two primitive");
 			return apply_two(car(args), car(nxt));
 		}
+		Obj *apply_values(Obj *const *values, unsigned count) override {
+			ASSERT(count == 2, "two primitive");
+			return apply_two(values[0], values[1]);
+		}
 };
 
 template<Obj *(FN)(Obj *, Obj *)> class Two_Primitive_Fn : public Two_Primitive {
@@ -71,6 +79,62 @@ template<bool (FN)(Obj *, Obj *)> class Binary_Predicate_Fn : public Two_Primiti
 		}
 };
 
+// combines the arguments from left to right; a single argument is
+// combined with the identity, so (- a) is (- 0 a)
+template<Obj *(FN)(Obj *, Obj *), std::intptr_t IDENTITY>
+class Fold_Primitive : public Primitive {
+	public:
+		Obj *apply(Obj *args) override {
+			Obj *result { make_fixnum(IDENTITY) };
+			if (is_pair(args) && is_pair(cdr(args))) {
+				result = car(args);
+				args = cdr(args);
+			}
+			for (; is_pair(args); args = cdr(args)) { result = FN(result, car(args)); }
+			ASSERT(is_null(args), "fold primitive");
+			return result;
+		}
+		Obj *apply_values(Obj *const *values, unsigned count) override {
+			if (count < 2) {
+				return count ? FN(make_fixnum(IDENTITY), values[0]) : make_fixnum(IDENTITY);
+			}
+			Obj *result { FN(values[0], values[1]) };
+			for (unsigned i { 2 }; i < count; ++i) { result = FN(result, values[i]); }
+			return result;
+		}
+		Binary_Entry binary_entry() const override { return FN; }
+};
+
+// true if FN holds for all neighboring arguments
+template<bool (FN)(Obj *, Obj *)> class Cascade_Primitive : public Primitive {
+		static Obj *binary(Obj *first, Obj *second) {
+			return to_bool(FN(first, second));
+		}
+	public:
+		Obj *apply(Obj *args) override {
+			ASSERT(is_pair(args) && is_pair(cdr(args)), "cascade primitive");
+			for (; is_pair(cdr(args)); args = cdr(args)) {
+				if (! FN(car(args), cadr(args))) { return false_obj; }
+			}
+			ASSERT(is_null(cdr(args)), "cascade primitive");
+			return true_obj;
+		}
+		Obj *apply_values(Obj *const *values, unsigned count) override {
+			ASSERT(count >= 2, "cascade primitive");
+			for (unsigned i { 1 }; i < count; ++i) {
+				if (! FN(values[i - 1], values[i])) { return false_obj; }
+			}
+			return true_obj;
+		}
+		Binary_Entry binary_entry() const override { return binary; }
+};
+
+inline bool num_less(Obj *first, Obj *second) { return is_true(less(first, second)); }
+inline bool num_greater(Obj *first, Obj *second) { return is_true(less(second, first)); }
+inline bool num_less_equal(Obj *first, Obj *second) { return is_false(less(second, first)); }
+inline bool num_greater_equal(Obj *first, Obj *second) { return is_false(less(first, second)); }
+inline bool num_equal(Obj *first, Obj *second) { return is_true(is_equal_num(first, second)); }
+
 class Apply_Primitive: public Primitive {
 		Obj *build_arg_lst(Obj *args) {
 			ASSERT(is_pair(args), "apply");
@@ -89,17 +153,18 @@ class Apply_Primitive: public Primitive {
 			ASSERT(is_pair(args), "apply");
 			auto proc { car(args) };
 			ASSERT(is_function(proc), "apply");
-			auto lst { build_arg_lst(cdr(args)) };
-			ASSERT(is_pair(lst), "apply");
-			return ::apply(proc, lst);
+			return ::apply(proc, build_arg_lst(cdr(args)));
 		}
 };
 
 Obj *remainder(Obj *first, Obj *second) {
-	auto a { as_integer(first) };
-	auto b { as_integer(second) };
+	if (is_fixnum(first) && is_fixnum(second) && fixnum_value(second)) {
+		return make_fixnum(fixnum_value(first) % fixnum_value(second));
+	}
+	auto a { to_bignum(first) };
+	auto b { to_bignum(second) };
 	ASSERT(a && b, "remainder");
-	return remainder(a, b);
+	return to_fixnum(remainder(a, b));
 }
 
 class Zero_Primitive : public Primitive {
@@ -110,6 +175,10 @@ class Zero_Primitive : public Primitive {
 			ASSERT(is_null(args), "zero primitive");
 			return apply_zero();
 		}
+		Obj *apply_values(Obj *const *, unsigned count) override {
+			ASSERT(count == 0, "zero primitive");
+			return apply_zero();
+		}
 };
 
 class Garbage_Collect_Primitive : public Zero_Primitive {
@@ -118,9 +187,9 @@ class Garbage_Collect_Primitive : public Zero_Primitive {
 			auto result { Obj::garbage_collect() };
 			return build_list(
 				Symbol::get("collected"),
-			       	Integer::create(result.first),
+			       	make_integer(result.first),
 				Symbol::get("kept"),
-				Integer::create(result.second)
+				make_integer(result.second)
 			);
 		}
 };
@@ -173,33 +242,49 @@ Obj *set_cdr(Obj *pair, Obj *new_cdr) {
 	return new_cdr;
 }
 
-Frame initial_frame { nullptr };
+Frame *initial_frame { nullptr };
 
 void setup_primitives() {
-	initial_frame.insert("symbol?", new Dynamic_Predicate<Symbol>());
-	initial_frame.insert("numeric?", new Dynamic_Predicate<Numeric>());
-	initial_frame.insert("complex?", new Dynamic_Predicate<Complex_Numeric>());
-	initial_frame.insert("pair?", new Dynamic_Predicate<Pair>());
-	initial_frame.insert("car", new One_Primitive_Fn<car>());
-	initial_frame.insert("cdr", new One_Primitive_Fn<cdr>());
-	initial_frame.insert("cons", new Two_Primitive_Fn<cons>());
-	initial_frame.insert("@binary+", new Two_Primitive_Fn<add>());
-	initial_frame.insert("@binary-", new Two_Primitive_Fn<sub>());
-	initial_frame.insert("@binary*", new Two_Primitive_Fn<mult>());
-	initial_frame.insert("@binary/", new Two_Primitive_Fn<div>());
-	initial_frame.insert("@negate", new One_Primitive_Fn<negate>());
-	initial_frame.insert("@negative?", new Predicate_Fn<is_negative>());
-	initial_frame.insert("@binary<", new Two_Primitive_Fn<less>());
-	initial_frame.insert("@binary=", new Two_Primitive_Fn<is_equal_num>());
-	initial_frame.insert("apply", new Apply_Primitive());
-	initial_frame.insert("garbage-collect", new Garbage_Collect_Primitive());
-	initial_frame.insert("@binary-eq?", new Binary_Predicate_Fn<eq>());
-	initial_frame.insert("@binary-eqv?", new Binary_Predicate_Fn<eqv>());
-	initial_frame.insert("remainder", new Two_Primitive_Fn<remainder>());
-	initial_frame.insert("newline", new Newline_Primitive());
-	initial_frame.insert("print", new Print_Primitive());
-	initial_frame.insert("set-car!", new Two_Primitive_Fn<set_car>());
-	initial_frame.insert("set-cdr!", new Two_Primitive_Fn<set_cdr>());
-	initial_frame.insert("int->float", new To_Float());
+	initial_frame = new Frame { nullptr };
+	initial_frame->insert("symbol?", new Dynamic_Predicate<Symbol>());
+	initial_frame->insert("numeric?", new Dynamic_Predicate<Numeric>());
+	initial_frame->insert("complex?", new Dynamic_Predicate<Complex_Numeric>());
+	initial_frame->insert("pair?", new Predicate_Fn<is_pair>());
+	initial_frame->insert("car", new One_Primitive_Fn<car>());
+	initial_frame->insert("cdr", new One_Primitive_Fn<cdr>());
+	initial_frame->insert("cons", new Two_Primitive_Fn<cons>());
+	initial_frame->insert("@binary+", new Two_Primitive_Fn<add>());
+	initial_frame->insert("@binary-", new Two_Primitive_Fn<sub>());
+	initial_frame->insert("@binary*", new Two_Primitive_Fn<mult>());
+	initial_frame->insert("@binary/", new Two_Primitive_Fn<div>());
+	initial_frame->insert("@negate", new One_Primitive_Fn<negate>());
+	initial_frame->insert("@negative?", new Predicate_Fn<is_negative>());
+	initial_frame->insert("@binary<", new Two_Primitive_Fn<less>());
+	initial_frame->insert("@binary=", new Two_Primitive_Fn<is_equal_num>());
+	initial_frame->insert("+", new Fold_Primitive<add, 0>());
+	initial_frame->insert("-", new Fold_Primitive<sub, 0>());
+	initial_frame->insert("*", new Fold_Primitive<mult, 1>());
+	initial_frame->insert("/", new Fold_Primitive<div, 1>());
+	initial_frame->insert("<", new Cascade_Primitive<num_less>());
+	initial_frame->insert(">", new Cascade_Primitive<num_greater>());
+	initial_frame->insert("<=", new Cascade_Primitive<num_less_equal>());
+	initial_frame->insert(">=", new Cascade_Primitive<num_greater_equal>());
+	initial_frame->insert("=", new Cascade_Primitive<num_equal>());
+	apply_primitive = new Apply_Primitive();
+	initial_frame->insert("apply", apply_primitive);
+	initial_frame->insert("garbage-collect", new Garbage_Collect_Primitive());
+	initial_frame->insert("@binary-eq?", new Binary_Predicate_Fn<eq>());
+	initial_frame->insert("@binary-eqv?", new Binary_Predicate_Fn<eqv>());
+	initial_frame->insert("eq?", new Cascade_Primitive<eq>());
+	initial_frame->insert("eqv?", new Cascade_Primitive<eqv>());
+	initial_frame->insert("remainder", new Two_Primitive_Fn<remainder>());
+	initial_frame->insert("newline", new Newline_Primitive());
+	initial_frame->insert("print", new Print_Primitive());
+	initial_frame->insert("set-car!", new Two_Primitive_Fn<set_car>());
+	initial_frame->insert("set-cdr!", new Two_Primitive_Fn<set_cdr>());
+	initial_frame->insert("int->float", new To_Float());
+	auto call_ec { new One_Primitive_Fn<Continuation::call_with>() };
+	initial_frame->insert("call-with-escape-continuation", call_ec);
+	initial_frame->insert("call/ec", call_ec);
 
 }
@@ -6,7 +6,7 @@
 
 #include "frame.h"
 
-extern Frame initial_frame;
+extern Frame *initial_frame;
 
 void setup_primitives();
 
@@ -0,0 +1,46 @@
+#include "runtime.h"
+#include "parser.h"
+#include "err.h"
+#include "eval.h"
+#include "primitives.h"
+#include "int.h"
+#include "stack.h"
+
+std::ostream *prompt { nullptr };
+std::ostream *result { nullptr };
+
+void process_stream(std::istream &in, bool with_header, bool exit_on_exception) {
+	active_frames.clear();
+	active_frames.push_back(initial_frame);
+
+	if (prompt) { *prompt << "? "; }
+	int ch = get(in);
+	if (with_header && ch == '#') {
+		while (ch != EOF && ch != '\n') { ch = get(in); }
+	}
+	for (;;) {
+		try {
+			auto exp { read_expression(in) };
+			if (! in) { break; }
+			exp = eval(exp, initial_frame);
+			if (result) { *result << exp << "\n"; }
+		} catch (Error *err) {
+			if (err_stream) { *err_stream << err << '\n'; }
+			if (exit_on_exception) { return; }
+		}
+		Obj::compact_if_due();
+		if (prompt) { *prompt << "? "; }
+	}
+}
+
+void setup_runtime() {
+	Stack::setup();
+	one = Integer::create(1);
+	two = Integer::create(2);
+	zero = Integer::create(0);
+	setup_primitives();
+	std::istringstream s { 
+		#include "scheme.scm.h"
+	};
+	process_stream(s, true, true);
+}
@@ -0,0 +1,16 @@
+/**
+ * set up the interpreter and evaluate streams of expressions
+ */
+
+#pragma once
+
+#include <iostream>
+
+// where the prompt and the results of expressions are written to
+extern std::ostream *prompt;
+extern std::ostream *result;
+
+void process_stream(std::istream &in, bool with_header, bool exit_on_exception);
+
+// create the primitives and evaluate the Scheme part of the runtime
+void setup_runtime();
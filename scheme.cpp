@@ -6,38 +6,18 @@
  * 3. speed
  */
 
-#include "parser.h"
-#include "err.h"
+#include "runtime.h"
+#include "translator.h"
 #include "eval.h"
-#include "frame.h"
-#include "primitives.h"
-#include "int.h"
-
-std::ostream *prompt { nullptr };
-std::ostream *result { nullptr };
+#include "syntax.h"
+#include "err.h"
+#include "heap.h"
+#include "stack.h"
 
-void process_stream(std::istream &in, bool with_header, bool exit_on_exception) {
-	active_frames.clear();
-	active_frames.push_back(&initial_frame);
-
-	if (prompt) { *prompt << "? "; }
-	int ch = get(in);
-	if (with_header && ch == '#') {
-		while (ch != EOF && ch != '\n') { ch = get(in); }
-	}
-	for (;;) {
-		try {
-			auto exp { read_expression(in) };
-			if (! in) { break; }
-			exp = eval(exp, &initial_frame);
-			if (result) { *result << exp << "\n"; }
-		} catch (Error *err) {
-			if (err_stream) { *err_stream << err << '\n'; }
-			if (exit_on_exception) { return; }
-		}
-		if (prompt) { *prompt << "? "; }
-	}
-}
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
 
 void process_stdin() {
 	auto old_prompt { prompt };
@@ -50,43 +30,178 @@ void process_stdin() {
 }
 
 void print_help() {
-	std::cout << "Usage: scheme [ --help ] [ FILE ]...\n"
+	std::cout << "Usage: scheme [ OPTION | FILE ]...\n"
 		"Interpret the Scheme FILEs.\n\n"
 		"Use standard input, if no files are specified or if - is\n"
 		"used as a file name.\n\n"
-		"    --help   display this help and exit\n";
+		"    --help                 display this help and exit\n"
+		"    --heap-nursery=BYTES   collect young objects after BYTES are\n"
+		"                           allocated\n"
+		"    --heap-initial=BYTES   collect old objects not before BYTES\n"
+		"                           are used\n"
+		"    --heap-growth=FACTOR   let the heap grow by FACTOR between\n"
+		"                           collections\n"
+		"    --heap-max=BYTES       raise an error if the heap is bigger\n"
+		"                           than BYTES after a collection\n"
+		"    --gc-slice=COUNT       mark or sweep COUNT objects per step\n"
+		"                           of an old collection\n"
+		"    --heap-compact         move lists together after old\n"
+		"                           collections\n"
+		"    --max-depth=COUNT      raise an error if evaluations nest\n"
+		"                           deeper than COUNT\n"
+		"    --engine=ENGINE        run the following files with ENGINE:\n"
+		"                           tree (default) or vm\n"
+		"    --compile              translate the following files to\n"
+		"                           a C++ program that is written to\n"
+		"                           standard output\n\n"
+		"BYTES can have a K, M or G suffix. FACTOR must be bigger than 1.\n"
+		"COUNT and the BYTES of --heap-nursery must not be 0.\n";
+}
+
+// the values throw std::invalid_argument or std::out_of_range if they
+// are malformed; stoul alone would accept a sign and trailing garbage
+static std::size_t count_value(const std::string &value, std::size_t &end) {
+	if (value.empty() || ! std::isdigit(static_cast<unsigned char>(value[0]))) {
+		throw std::invalid_argument { value };
+	}
+	return std::stoul(value, &end);
+}
+
+static std::size_t count_value(const std::string &value) {
+	std::size_t end;
+	auto result { count_value(value, end) };
+	if (end != value.size()) { throw std::invalid_argument { value }; }
+	return result;
+}
+
+static std::size_t size_value(const std::string &value) {
+	std::size_t end;
+	auto result { count_value(value, end) };
+	if (end == value.size()) { return result; }
+	if (end + 1 != value.size()) { throw std::invalid_argument { value }; }
+	unsigned shift { 0 };
+	switch (value[end]) {
+		case 'G': case 'g': shift += 10; [[fallthrough]];
+		case 'M': case 'm': shift += 10; [[fallthrough]];
+		case 'K': case 'k': shift += 10; break;
+		default: throw std::invalid_argument { value };
+	}
+	if (result > std::numeric_limits<std::size_t>::max() >> shift) {
+		throw std::out_of_range { value };
+	}
+	return result << shift;
+}
+
+// zero would stop the collector or every evaluation
+static std::size_t positive(std::size_t value) {
+	if (! value) { throw std::invalid_argument { "0" }; }
+	return value;
+}
+
+// the heap must grow between collections
+static double factor_value(const std::string &value) {
+	std::size_t end;
+	auto result { std::stod(value, &end) };
+	if (end != value.size() || ! std::isfinite(result) || result <= 1) {
+		throw std::invalid_argument { value };
+	}
+	return result;
+}
+
+static bool heap_option(const std::string &arg) {
+	auto pos { arg.find('=') };
+	if (pos == std::string::npos) { return false; }
+	auto key { arg.substr(0, pos) };
+	auto value { arg.substr(pos + 1) };
+	try {
+		if (key == "--heap-nursery") {
+			Heap::nursery_size = positive(size_value(value));
+		} else if (key == "--heap-initial") {
+			Heap::initial_size = Heap::next_collection = size_value(value);
+		} else if (key == "--heap-growth") {
+			Heap::growth_factor = factor_value(value);
+		} else if (key == "--heap-max") {
+			Heap::max_size = size_value(value);
+		} else if (key == "--gc-slice") {
+			Heap::slice_budget = positive(count_value(value));
+		} else if (key == "--max-depth") {
+			Stack::max_depth = positive(count_value(value));
+		} else { return false; }
+	} catch (const std::logic_error &) {
+		std::cerr << "invalid value in " << arg << "\n"
+			"Try 'scheme --help' for more information.\n";
+		std::exit(EXIT_FAILURE);
+	}
+	return true;
 }
 
+static bool engine_option(const std::string &arg) {
+	const std::string prefix { "--engine=" };
+	if (arg.compare(0, prefix.size(), prefix)) { return false; }
+	auto value { arg.substr(prefix.size()) };
+	if (value == "tree") {
+		engine = Engine::tree;
+	} else if (value == "vm") {
+		engine = Engine::vm;
+	} else {
+		std::cerr << "unknown engine " << value << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+	return true;
+}
+
+#include <cstdlib>
 #include <fstream>
 
-int main(int argc, const char *argv[]) {
-	one = Integer::create(1);
-	two = Integer::create(2);
-	zero = Integer::create(0);
-	setup_primitives();
-	{
-		std::istringstream s { 
-			#include "scheme.scm.h"
-		};
-		process_stream(s, true, true);
+// translates the files after --compile
+static Translator *translator { nullptr };
+
+static void process_file(const char *path) {
+	std::ifstream in { path };
+	if (translator) {
+		try {
+			translate_stream(in, *translator);
+		} catch (Error *err) {
+			std::cerr << err << '\n';
+			std::exit(EXIT_FAILURE);
+		}
+		return;
 	}
+	auto old_result { result };
+	result = &std::cout;
+	process_stream(in, true, true);
+	result = old_result;
+}
+
+int main(int argc, const char *argv[]) {
+	setup_runtime();
 	syntax_tests();
-	if (argc > 1) {
-		for (int i { 1 }; i < argc; ++i) {
-			if (argv[i] == std::string { "--help" }) {
-				print_help();
-				break;
-			} else if (argv[i] == std::string { "-" }) {
-				process_stdin();
-			} else {
-				std::ifstream in { argv[i] };
-				auto old_result { result };
-				result = &std::cout;
-				process_stream(in, true, true);
-				result = old_result;
-			}
+	bool processed { false };
+	for (int i { 1 }; i < argc; ++i) {
+		if (argv[i] == std::string { "--help" }) {
+			print_help();
+			processed = true;
+			break;
+		} else if (heap_option(argv[i])) {
+			continue;
+		} else if (engine_option(argv[i])) {
+			continue;
+		} else if (argv[i] == std::string { "--heap-compact" }) {
+			Heap::compaction = true;
+			continue;
+		} else if (argv[i] == std::string { "--compile" }) {
+			if (! translator) { translator = new Translator { }; }
+			continue;
+		} else if (argv[i] == std::string { "-" }) {
+			process_stdin();
+		} else {
+			process_file(argv[i]);
 		}
-	} else {
+		processed = true;
+	}
+	if (translator) {
+		translator->write(std::cout);
+	} else if (! processed) {
 		process_stdin();
 	}
 }
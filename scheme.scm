@@ -8,42 +8,11 @@
 (define false #f)
 (define (null? a) (eq? a nil))
 
-(define (@numeric-cascade op)
-  (let ([fn #f])
-    (set! fn (case-lambda
-               [(a b) (op a b)]
-               [(a b c . r) (and (op a b) (apply fn b c r))]))
-    fn))
-
-(define (@binary> a b) (@binary< b a))
-(define (@binary<= a b) (not (@binary> a b)))
-(define (@binary>= a b) (not (@binary< a b)))
-(define < (@numeric-cascade @binary<))
-(define > (@numeric-cascade @binary>))
-(define <= (@numeric-cascade @binary<=))
-(define >= (@numeric-cascade @binary>=))
-(define = (@numeric-cascade @binary=))
-(define eq? (@numeric-cascade @binary-eq?))
-(define eqv? (@numeric-cascade @binary-eqv?))
 (define (not a) (if a #f #t))
 (define (abs x) (if (< x 0) (- x) x))
 (define (even? x) (= (remainder x 2) 0))
 (define (odd? x) (not (even? x)))
 
-(define (@numeric-op op zero)
-   (let ([fn #f])
-     (set! fn (case-lambda
-	        [() zero]
-		[(a) (op zero a)]
-		[(a b) (op a b)]
-		[(a b c . r) (apply fn (op a b) c r)]
-	      ))))
-
-(define + (@numeric-op @binary+ 0))
-(define - (@numeric-op @binary- 0))
-(define * (@numeric-op @binary* 1))
-(define / (@numeric-op @binary/ 1))
-
 (define (map f ls . more)
   (if (null? more)
       (let map1 ([ls ls])
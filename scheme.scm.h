@@ -8,42 +8,11 @@
 "(define false #f)\n"
 "(define (null? a) (eq? a nil))\n"
 "\n"
-"(define (@numeric-cascade op)\n"
-"  (let ([fn #f])\n"
-"    (set! fn (case-lambda\n"
-"               [(a b) (op a b)]\n"
-"               [(a b c . r) (and (op a b) (apply fn b c r))]))\n"
-"    fn))\n"
-"\n"
-"(define (@binary> a b) (@binary< b a))\n"
-"(define (@binary<= a b) (not (@binary> a b)))\n"
-"(define (@binary>= a b) (not (@binary< a b)))\n"
-"(define < (@numeric-cascade @binary<))\n"
-"(define > (@numeric-cascade @binary>))\n"
-"(define <= (@numeric-cascade @binary<=))\n"
-"(define >= (@numeric-cascade @binary>=))\n"
-"(define = (@numeric-cascade @binary=))\n"
-"(define eq? (@numeric-cascade @binary-eq?))\n"
-"(define eqv? (@numeric-cascade @binary-eqv?))\n"
 "(define (not a) (if a #f #t))\n"
 "(define (abs x) (if (< x 0) (- x) x))\n"
 "(define (even? x) (= (remainder x 2) 0))\n"
 "(define (odd? x) (not (even? x)))\n"
 "\n"
-"(define (@numeric-op op zero)\n"
-"   (let ([fn #f])\n"
-"     (set! fn (case-lambda\n"
-"\t        [() zero]\n"
-"\t\t[(a) (op zero a)]\n"
-"\t\t[(a b) (op a b)]\n"
-"\t\t[(a b c . r) (apply fn (op a b) c r)]\n"
-"\t      ))))\n"
-"\n"
-"(define + (@numeric-op @binary+ 0))\n"
-"(define - (@numeric-op @binary- 0))\n"
-"(define * (@numeric-op @binary* 1))\n"
-"(define / (@numeric-op @binary/ 1))\n"
-"\n"
 "(define (map f ls . more)\n"
 "  (if (null? more)\n"
 "      (let map1 ([ls ls])\n"
@@ -0,0 +1,81 @@
+#include "stack.h"
+#include "err.h"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <vector>
+
+#include <sys/resource.h>
+#include <ucontext.h>
+
+std::size_t Stack::segment_size { 4 * 1024 * 1024 };
+std::size_t Stack::max_depth { 1000000 };
+std::size_t Stack::depth { 0 };
+std::uintptr_t Stack::limit { 0 };
+
+namespace {
+	// the space that is left for the code between two checks
+	constexpr std::size_t reserve { 256 * 1024 };
+
+	// the stack of the thread may be unlimited, but not all of it can
+	// be used
+	constexpr std::size_t max_thread_stack { 8 * 1024 * 1024 };
+
+	std::vector<std::unique_ptr<char[]>> segments;
+	std::size_t used_segments { 0 };
+
+	struct Call {
+		const std::function<void()> *fn;
+		std::exception_ptr error;
+		ucontext_t caller;
+	};
+
+	Call *pending { nullptr };
+
+	// the exceptions can not leave the segment
+	void start() {
+		auto call { pending };
+		try {
+			(*call->fn)();
+		} catch (...) {
+			call->error = std::current_exception();
+		}
+	}
+}
+
+void Stack::setup() {
+	rlimit rl;
+	std::size_t size { max_thread_stack };
+	if (! getrlimit(RLIMIT_STACK, &rl) && rl.rlim_cur != RLIM_INFINITY) {
+		size = std::min(size, static_cast<std::size_t>(rl.rlim_cur));
+	}
+	limit = reinterpret_cast<std::uintptr_t>(__builtin_frame_address(0)) -
+		size + reserve;
+}
+
+void Stack::on_new_segment(const std::function<void()> &fn) {
+	if (used_segments == segments.size()) {
+		segments.emplace_back(new char[segment_size]);
+	}
+	auto memory { segments[used_segments++].get() };
+	Call call { &fn, nullptr, { } };
+	ucontext_t context;
+	getcontext(&context);
+	context.uc_stack.ss_sp = memory;
+	context.uc_stack.ss_size = segment_size;
+	context.uc_link = &call.caller;
+	makecontext(&context, start, 0);
+	auto old_limit { limit };
+	limit = reinterpret_cast<std::uintptr_t>(memory) + reserve;
+	pending = &call;
+	swapcontext(&call.caller, &context);
+	limit = old_limit;
+	--used_segments;
+	if (segments.size() > used_segments + 1) { segments.pop_back(); }
+	if (call.error) { std::rethrow_exception(call.error); }
+}
+
+void Stack::too_deep() {
+	throw new Error { "eval", "recursion too deep", nullptr, nullptr };
+}
@@ -0,0 +1,60 @@
+/**
+ * the control stack of the evaluator
+ * nested evaluations recurse in C++, so deep non-tail recursion in
+ * Scheme code needs a deep C++ stack; so do the reader, the analyzer,
+ * the printer and the syntax extensions for deeply nested data
+ * when the current stack is nearly used up, the evaluation continues
+ * on a new segment that is allocated on the heap; segments are
+ * released when the evaluation returns, but one is kept for the next
+ * time
+ * the depth of the nested evaluations is limited, deeper recursion
+ * raises an error
+ * a recursive function calls itself with extend if is_low and then
+ * holds a Depth_Guard
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+namespace Stack {
+	extern std::size_t segment_size;
+	extern std::size_t max_depth;
+	extern std::size_t depth;
+
+	// the lowest address that an evaluation may start at
+	extern std::uintptr_t limit;
+
+	// the limit of the stack of the calling thread
+	void setup();
+
+	inline bool is_low() {
+		return reinterpret_cast<std::uintptr_t>(__builtin_frame_address(0)) < limit;
+	}
+
+	// runs fn on a new segment; exceptions are passed on to the caller
+	void on_new_segment(const std::function<void()> &fn);
+
+	// the value of fn that runs on a new segment
+	template<typename Fn> auto extend(const Fn &fn) -> decltype(fn()) {
+		if constexpr (std::is_void_v<decltype(fn())>) {
+			on_new_segment([&]() { fn(); });
+		} else {
+			decltype(fn()) value { };
+			on_new_segment([&]() { value = fn(); });
+			return value;
+		}
+	}
+
+	[[noreturn]] void too_deep();
+
+	// counts a nested evaluation
+	class Depth_Guard {
+		public:
+			Depth_Guard() { if (++depth > max_depth) { --depth; too_deep(); } }
+			~Depth_Guard() { --depth; }
+	};
+}
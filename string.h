@@ -3,7 +3,7 @@
 #include "value.h"
 #include "dynamic.h"
 
-class String : public Value_Element<std::string> {
+class String : public Value_Element<std::string, Obj, Tag::string> {
 	public:
 		String(const std::string &value) : Value_Element(value) { }
 		std::ostream &write(std::ostream &out) override {
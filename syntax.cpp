@@ -0,0 +1,369 @@
+#include "syntax.h"
+#include "parser.h"
+#include "err.h"
+#include "num.h"
+#include "int.h"
+#include "string.h"
+#include "stack.h"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <unordered_map>
+
+static bool is_ellipsis(Obj *obj) {
+	static auto ellipsis { Symbol::get("...") };
+	return obj == ellipsis;
+}
+
+static bool is_underscore(Obj *obj) {
+	static auto underscore { Symbol::get("_") };
+	return obj == underscore;
+}
+
+// literals of patterns are compared like eqv? and strings by value
+static bool same_datum(Obj *a, Obj *b) {
+	if (a == b) { return true; }
+	if (is_numeric(a) && is_numeric(b)) { return is_true(is_equal_num(a, b)); }
+	auto sa { as_string(a) };
+	auto sb { as_string(b) };
+	return sa && sb && sa->value() == sb->value();
+}
+
+static Obj *to_list(const std::vector<Obj *> &elements, Obj *rest = nullptr) {
+	for (auto i { elements.size() }; i; --i) { rest = cons(elements[i - 1], rest); }
+	return rest;
+}
+
+bool Matcher::match(Obj *value, Bindings &bindings) const {
+	switch (kind) {
+		case Kind::ignore: return true;
+		case Kind::variable: bindings[slot] = value; return true;
+		case Kind::literal: return same_datum(literal, value);
+		case Kind::list: break;
+	}
+	if (Stack::is_low()) {
+		return Stack::extend([&]() { return match(value, bindings); });
+	}
+	Stack::Depth_Guard depth_guard;
+	for (auto &element : before) {
+		auto pair { as_pair(value) };
+		if (! pair || ! element.match(pair->head(), bindings)) { return false; }
+		value = pair->rest();
+	}
+	if (repeated.empty()) {
+		return tail.empty() ? is_null(value) : tail[0].match(value, bindings);
+	}
+	std::vector<Obj *> items;
+	for (; is_pair(value); value = cdr(value)) { items.push_back(car(value)); }
+	if (items.size() < after.size() || (tail.empty() && value)) { return false; }
+	auto count { items.size() - after.size() };
+	std::vector<std::vector<Obj *>> collected(repeated_slots.size());
+	for (std::size_t i { 0 }; i < count; ++i) {
+		if (! repeated[0].match(items[i], bindings)) { return false; }
+		for (std::size_t j { 0 }; j < repeated_slots.size(); ++j) {
+			collected[j].push_back(bindings[repeated_slots[j]]);
+		}
+	}
+	for (std::size_t j { 0 }; j < repeated_slots.size(); ++j) {
+		bindings[repeated_slots[j]] = to_list(collected[j]);
+	}
+	for (std::size_t i { 0 }; i < after.size(); ++i) {
+		if (! after[i].match(items[count + i], bindings)) { return false; }
+	}
+	return tail.empty() || tail[0].match(value, bindings);
+}
+
+Obj *Expander::expand(Bindings &bindings) const {
+	switch (kind) {
+		case Kind::constant: return constant;
+		case Kind::variable: return bindings[slot];
+		default: break;
+	}
+	if (Stack::is_low()) {
+		return Stack::extend([&]() { return expand(bindings); });
+	}
+	Stack::Depth_Guard depth_guard;
+	std::vector<Obj *> result;
+	for (auto &element : elements) {
+		if (element.kind == Kind::repeat) {
+			element.expand_into(bindings, result);
+		} else {
+			result.push_back(element.expand(bindings));
+		}
+	}
+	return to_list(result, tail.empty() ? nullptr : tail[0].expand(bindings));
+}
+
+// the iterated variables are bound to one element of their lists
+// after the other
+void Expander::expand_into(Bindings &bindings, std::vector<Obj *> &result) const {
+	std::vector<Obj *> lists;
+	for (auto slot : iterated) { lists.push_back(bindings[slot]); }
+	auto saved { lists };
+	auto &element { elements[0] };
+	for (;;) {
+		unsigned ended { 0 };
+		for (auto lst : lists) { if (! is_pair(lst)) { ++ended; } }
+		if (ended == lists.size()) { break; }
+		if (ended) { err("syntax", "different lengths for ..."); }
+		for (std::size_t i { 0 }; i < iterated.size(); ++i) {
+			bindings[iterated[i]] = car(lists[i]);
+			lists[i] = cdr(lists[i]);
+		}
+		if (element.kind == Kind::repeat) {
+			element.expand_into(bindings, result);
+		} else {
+			result.push_back(element.expand(bindings));
+		}
+	}
+	for (std::size_t i { 0 }; i < iterated.size(); ++i) {
+		bindings[iterated[i]] = saved[i];
+	}
+}
+
+namespace {
+	// numbers the pattern variables of a rule and resolves them in
+	// the template
+	class Rule_Compiler {
+			const Syntax &syntax_;
+			std::unordered_map<Symbol *, unsigned> slots_;
+			std::vector<unsigned> depths_;
+
+			void add_slots(std::vector<unsigned> &slots, const std::vector<unsigned> &more) {
+				for (auto slot : more) {
+					if (std::find(slots.begin(), slots.end(), slot) == slots.end()) {
+						slots.push_back(slot);
+					}
+				}
+			}
+		public:
+			Rule_Compiler(const Syntax &syntax): syntax_ { syntax } { }
+			unsigned slot_count() const { return depths_.size(); }
+
+			Matcher pattern(Obj *pattern, unsigned depth) {
+				if (Stack::is_low()) {
+					return Stack::extend([&]() { return this->pattern(pattern, depth); });
+				}
+				Stack::Depth_Guard depth_guard;
+				Matcher result;
+				if (auto sym { as_symbol(pattern) }) {
+					if (syntax_.is_keyword(sym)) {
+						result.kind = Matcher::Kind::literal;
+						result.literal = sym;
+					} else if (is_underscore(sym)) {
+						result.kind = Matcher::Kind::ignore;
+					} else if (is_ellipsis(sym)) {
+						err("syntax-rules", "misplaced ...");
+					} else {
+						if (slots_.count(sym)) {
+							err("syntax-rules", "duplicate pattern variable", sym);
+						}
+						result.kind = Matcher::Kind::variable;
+						result.slot = slots_[sym] = depths_.size();
+						depths_.push_back(depth);
+					}
+					return result;
+				}
+				if (pattern && ! is_pair(pattern)) {
+					result.kind = Matcher::Kind::literal;
+					result.literal = pattern;
+					return result;
+				}
+				result.kind = Matcher::Kind::list;
+				for (; is_pair(pattern); pattern = cdr(pattern)) {
+					auto element { car(pattern) };
+					if (is_pair(cdr(pattern)) && is_ellipsis(cadr(pattern))) {
+						if (! result.repeated.empty()) {
+							err("syntax-rules", "more than one ...", pattern);
+						}
+						auto first_slot { slot_count() };
+						result.repeated.push_back(this->pattern(element, depth + 1));
+						for (auto slot { first_slot }; slot < slot_count(); ++slot) {
+							result.repeated_slots.push_back(slot);
+						}
+						pattern = cdr(pattern);
+						continue;
+					}
+					auto &list { result.repeated.empty() ? result.before : result.after };
+					list.push_back(this->pattern(element, depth));
+				}
+				if (pattern) { result.tail.push_back(this->pattern(pattern, depth)); }
+				return result;
+			}
+
+			// escaped templates insert ellipses literally
+			Expander replacement(Obj *replacement, unsigned depth, bool escaped) {
+				if (Stack::is_low()) {
+					return Stack::extend([&]() {
+						return this->replacement(replacement, depth, escaped);
+					});
+				}
+				Stack::Depth_Guard depth_guard;
+				Expander result;
+				if (auto sym { as_symbol(replacement) }) {
+					auto got { slots_.find(sym) };
+					if (got == slots_.end()) {
+						result.constant = sym;
+						return result;
+					}
+					auto slot { got->second };
+					if (depths_[slot] > depth) {
+						err("syntax-rules", "missing ... after", sym);
+					}
+					result.kind = Expander::Kind::variable;
+					result.slot = slot;
+					result.slots.push_back(slot);
+					return result;
+				}
+				if (! is_pair(replacement)) {
+					result.constant = replacement;
+					return result;
+				}
+				if (! escaped && is_ellipsis(car(replacement))) {
+					ASSERT(is_pair(cdr(replacement)) && ! cddr(replacement), "syntax-rules");
+					return this->replacement(cadr(replacement), depth, true);
+				}
+				result.kind = Expander::Kind::list;
+				for (; is_pair(replacement); replacement = cdr(replacement)) {
+					auto source { car(replacement) };
+					unsigned count { 0 };
+					while (
+						! escaped && is_pair(cdr(replacement)) &&
+						is_ellipsis(cadr(replacement))
+					) {
+						++count;
+						replacement = cdr(replacement);
+					}
+					auto element { this->replacement(source, depth + count, escaped) };
+					for (; count; --count) {
+						Expander repeat;
+						repeat.kind = Expander::Kind::repeat;
+						repeat.slots = element.slots;
+						for (auto slot : element.slots) {
+							if (depths_[slot] >= depth + count) {
+								repeat.iterated.push_back(slot);
+							}
+						}
+						if (repeat.iterated.empty()) {
+							err("syntax-rules", "no pattern variable before ...");
+						}
+						repeat.elements.push_back(std::move(element));
+						element = std::move(repeat);
+					}
+					add_slots(result.slots, element.slots);
+					result.elements.push_back(std::move(element));
+				}
+				if (replacement) {
+					result.tail.push_back(this->replacement(replacement, depth, escaped));
+					add_slots(result.slots, result.tail[0].slots);
+				}
+				return result;
+			}
+	};
+}
+
+// the keyword at the start of the pattern is ignored
+void Syntax::add_rule(Obj *pattern, Obj *replacement) {
+	ASSERT(is_pair(pattern), "syntax-rules");
+	Rule_Compiler compiler { *this };
+	Matcher matcher { compiler.pattern(cdr(pattern), 0) };
+	Expander expander { compiler.replacement(replacement, 0, false) };
+	rules_.push_back({
+		pattern, replacement, std::move(matcher), std::move(expander),
+		compiler.slot_count()
+	});
+}
+
+Obj *Syntax::expand(Obj *lst) {
+	Bindings bindings;
+	for (auto &rule : rules_) {
+		bindings.assign(rule.slot_count, nullptr);
+		if (rule.matcher.match(cdr(lst), bindings)) {
+			return rule.expander.expand(bindings);
+		}
+	}
+	err("syntax", "no match", lst);
+	return nullptr;
+}
+
+void Syntax::propagate_mark() {
+	for (auto &rule : rules_) {
+		mark(rule.pattern);
+		mark(rule.replacement);
+	}
+}
+
+void Syntax::forward_references() {
+	for (auto &rule : rules_) {
+		forward(rule.pattern);
+		forward(rule.replacement);
+	}
+}
+
+static std::unordered_map<Symbol *, Syntax *> syntax_extensions;
+
+Syntax *find_syntax_extension(Obj *lst) {
+	if (syntax_extensions.empty()) { return nullptr; }
+	if (auto sym { as_symbol(car(lst)) }) {
+		auto got { syntax_extensions.find(sym) };
+		if (got != syntax_extensions.end()) {
+			return got->second;
+		}
+	}
+	return nullptr;
+}
+
+Syntax *define_syntax(Pair *lst) {
+	auto name { as_symbol(cadr(lst)) };
+	auto rules { as_pair(caddr(lst)) };
+	ASSERT(name && rules && ! cdddr(lst), "syntax-rules");
+	auto kind { as_symbol(car(rules)) };
+	ASSERT(kind && kind->special() == Special::syntax_rules, "syntax-rules");
+	auto se { new Syntax { name->value() } };
+	auto keywords { cadr(rules) };
+	for (; keywords; keywords = cdr(keywords)) {
+		ASSERT(is_pair(keywords), "syntax-rules");
+		auto sym { as_symbol(car(keywords)) };
+		ASSERT(sym, "syntax-rules");
+		se->add_keyword(sym);
+	}
+	auto cur { cddr(rules) };
+	for (; cur; cur = cdr(cur)) {
+		ASSERT(is_pair(cur), "syntax-rules");
+		auto rule { as_pair(car(cur)) };
+		ASSERT(rule && is_pair(cdr(rule)) && ! cddr(rule), "syntax-rules");
+		se->add_rule(car(rule), cadr(rule));
+	}
+	syntax_extensions[name] = se;
+	return se;
+}
+
+void foreach_syntax_extension(std::function<void(Obj *)> fn) {
+	for (auto &[key, obj] : syntax_extensions) { fn(obj); }
+}
+
+static std::string written(Obj *obj) {
+	std::ostringstream out;
+	out << obj;
+	return out.str();
+}
+
+static void assert_expansion(Syntax *s, const char *use, const char *expected) {
+	auto expansion { s->expand(parse_expression(use)) };
+	assert(written(expansion) == written(parse_expression(expected)));
+}
+
+void syntax_tests() {
+	auto s { new Syntax { "test" } };
+	s->add_keyword(Symbol::get("foo"));
+	s->add_rule(parse_expression("(_ foo x)"), parse_expression("(quote x)"));
+	s->add_rule(parse_expression("(_ x)"), parse_expression("(* x x)"));
+	s->add_rule(parse_expression("(_ (a b ...) ...)"), parse_expression("(list (a b ... 0) ... (b ... ...))"));
+	s->add_rule(parse_expression("(_ x y ... z . r)"), parse_expression("(x (y ...) z r (... ...))"));
+	assert_expansion(s, "(test 42)", "(* 42 42)");
+	assert_expansion(s, "(test foo 42)", "(quote 42)");
+	assert_expansion(s, "(test)", "(list ())");
+	assert_expansion(s, "(test (1 2 3) (4))", "(list (1 2 3 0) (4 0) (2 3))");
+	assert_expansion(s, "(test 1 2 3 4 . 5)", "(1 (2 3) 4 5 ...)");
+}
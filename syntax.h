@@ -0,0 +1,108 @@
+/**
+ * syntax extensions defined by define-syntax and syntax-rules
+ * the pattern of each rule is compiled into a matcher and its template
+ * into an expander; the pattern variables are numbered and a match
+ * stores their values in a vector of slots
+ * a variable that is followed by n ellipses in the pattern is bound
+ * to a list that is nested n levels deep
+ * a use of a macro is expanded when the form is analyzed; the analyzed
+ * nodes of the expansion take its place, so it is not expanded again
+ * the expansion is not hygienic: the symbols of the template are
+ * inserted as they are
+ */
+
+#pragma once
+
+#include "types.h"
+
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+using Bindings = std::vector<Obj *>;
+
+class Matcher {
+	public:
+		enum class Kind { ignore, variable, literal, list };
+		Kind kind { Kind::ignore };
+		unsigned slot { 0 };
+		Obj *literal { nullptr };
+
+		// a list pattern: the elements before the one that is followed
+		// by an ellipsis, that element, the elements after it and the
+		// pattern of the end of the list; the vectors of repeated and
+		// tail have at most one element
+		std::vector<Matcher> before;
+		std::vector<Matcher> repeated;
+		std::vector<Matcher> after;
+		std::vector<Matcher> tail;
+		// the variables in repeated
+		std::vector<unsigned> repeated_slots;
+
+		bool match(Obj *value, Bindings &bindings) const;
+};
+
+class Expander {
+	public:
+		// a repeat expands its element once for each value of the
+		// variables that it iterates
+		enum class Kind { constant, variable, list, repeat };
+		Kind kind { Kind::constant };
+		Obj *constant { nullptr };
+		unsigned slot { 0 };
+
+		// the elements of a list or the element of a repeat
+		std::vector<Expander> elements;
+		std::vector<Expander> tail;
+		// the variables that are used in the elements
+		std::vector<unsigned> slots;
+		// the variables that a repeat iterates
+		std::vector<unsigned> iterated;
+
+		Obj *expand(Bindings &bindings) const;
+		void expand_into(Bindings &bindings, std::vector<Obj *> &result) const;
+};
+
+struct Syntax_Rule {
+	Obj *pattern;
+	Obj *replacement;
+	Matcher matcher;
+	Expander expander;
+	unsigned slot_count;
+};
+
+class Syntax : public Obj {
+		const std::string name_;
+		std::set<Symbol *> keywords_;
+		std::vector<Syntax_Rule> rules_;
+	protected:
+		void propagate_mark() override;
+		void forward_references() override;
+	public:
+		Syntax(const std::string &name): name_ { name } { }
+		const std::string &name() const { return name_; }
+		void add_keyword(Symbol *keyword) { keywords_.insert(keyword); }
+		bool is_keyword(Symbol *sym) const {
+			return keywords_.find(sym) != keywords_.end();
+		}
+		// keywords must be added before the rules
+		void add_rule(Obj *pattern, Obj *replacement);
+
+		// expand lst with the first rule that matches
+		Obj *expand(Obj *lst);
+
+		std::ostream &write(std::ostream &out) override {
+			return out << "#syntax";
+		}
+};
+
+// the syntax extension of the form lst or nullptr
+Syntax *find_syntax_extension(Obj *lst);
+
+// register the extension of (define-syntax name (syntax-rules ...))
+Syntax *define_syntax(Pair *lst);
+
+void foreach_syntax_extension(std::function<void(Obj *)> fn);
+
+void syntax_tests();
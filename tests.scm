@@ -58,7 +58,14 @@
  (assert (= (/ 10000 100) 100)))
 
 'remainder
-(assert (= (remainder 6 3) 0))
+(and (assert (= (remainder 6 3) 0))
+ (assert (= (remainder -7 2) -1)))
+
+'overflow
+(and (assert (= (+ 4611686018427387903 1) 4611686018427387904))
+ (assert (= (- -4611686018427387904 1) -4611686018427387905))
+ (assert (= (* 99999999999 99999999999) 9999999999800000000001))
+ (assert (eq? (- (+ 4611686018427387903 1) 1) 4611686018427387903)))
 
 'and
 (and (assert (and))
@@ -73,3 +80,196 @@
  (assert (= (or 1 2 3) 1)))
 
 (assert (< (int->float -6) 0))
+
+'garbage-collect
+(assert (pair? (cons 1 (garbage-collect))))
+
+'deep-list
+((lambda ()
+   (define (build n lst) (if (= n 0) lst (build (- n 1) (cons n lst))))
+   (define lst (build 100000 '()))
+   (garbage-collect)
+   (assert (= (car lst) 1))))
+
+'write-barrier
+(define barrier-test (list 1 2))
+(garbage-collect)
+(set-car! barrier-test (list 3 4))
+((lambda ()
+   (define (loop n) (if (= n 0) 0 (begin (cons n n) (loop (- n 1)))))
+   (loop 20000)))
+(assert (= (car (car barrier-test)) 3))
+
+'lexical-scope
+(define scope-x 1)
+(define (scope-counter)
+  (define n 0)
+  (lambda () (set! n (+ n 1)) n))
+(define scope-count (scope-counter))
+(scope-count)
+(assert (= (scope-count) 2))
+((lambda (scope-x)
+   (assert (= scope-x 2))
+   (assert (= ((lambda (y) (+ scope-x y)) 3) 5))
+   (let ((scope-x 10)) (assert (= scope-x 10))))
+ 2)
+(assert (= scope-x 1))
+((lambda ()
+   (define before scope-x)
+   (define scope-x 3)
+   (assert (= before 1))
+   (assert (= scope-x 3))))
+(assert (= ((case-lambda ((a) a) ((a b) (+ a b))) 1 2) 3))
+
+'global-cells
+(define (global-user) (global-later 2))
+(define (global-later x) (* x 3))
+(assert (= (global-user) 6))
+(define (global-later x) (* x 4))
+(assert (= (global-user) 8))
+(set! global-later (lambda (x) x))
+(assert (= (global-user) 2))
+
+'derived-forms
+(define (derived-sum n)
+  (let loop ((i 0) (acc 0))
+    (cond
+      ((= i n) acc)
+      (else (loop (+ i 1) (let ((x i) (y 2)) (+ acc (* x y))))))))
+(assert (= (derived-sum 10) 90))
+(assert (= (derived-sum 10) 90))
+(define derived-loop (let loop ((i 0)) loop))
+(assert (eq? (derived-loop 5) derived-loop))
+(assert (eq? (cond) '()))
+(assert (= (let ((a 1)) (let ((a 2) (b a)) (+ a b))) 3))
+
+'syntax-rules
+(define-syntax swap!
+  (syntax-rules ()
+    ((_ a b) (let ((tmp a)) (set! a b) (set! b tmp)))))
+(define swap-x 1)
+(define swap-y 2)
+(swap! swap-x swap-y)
+(assert (= swap-x 2))
+(assert (= swap-y 1))
+(define-syntax my-or
+  (syntax-rules ()
+    ((_) #f)
+    ((_ e) e)
+    ((_ e r ...) (let ((t e)) (if t t (my-or r ...))))))
+(assert (= (my-or #f #f 3) 3))
+(assert (eq? (my-or) #f))
+(define-syntax my-let*
+  (syntax-rules ()
+    ((_ () body ...) (let () body ...))
+    ((_ ((x v) rest ...) body ...) (let ((x v)) (my-let* (rest ...) body ...)))))
+(assert (= (my-let* ((a 1) (b (+ a 1))) (* a b)) 2))
+(define-syntax flatten
+  (syntax-rules (=>)
+    ((_ => (a ...) ...) '(a ... ...))))
+(assert (= (car (cdr (cdr (flatten => (1 2) () (3))))) 3))
+(define (syntax-loop n)
+  (define count 0)
+  (define-syntax incr! (syntax-rules () ((_ v) (set! v (+ v 1)))))
+  (let loop ((i 0)) (if (< i n) (begin (incr! count) (loop (+ i 1)))))
+  count)
+(assert (= (syntax-loop 5) 5))
+
+'arguments
+(define (arguments-depth n a b c)
+  (if (= n 0) (+ a b c) (+ 1 (arguments-depth (- n 1) a b c))))
+(assert (= (arguments-depth 3000 1 2 3) 3006))
+(assert (= (cdr (apply cons 1 '(2))) (car (cons (apply car '((2))) 3))))
+(assert (= (apply + 1 2 '(3 4)) 10))
+
+'case-lambda
+(define case-arity
+  (case-lambda
+    ((a b c) 3)
+    (() 0)
+    ((a) 1)
+    ((a b . rest) 'rest)
+    ((a b) 2)))
+(assert (eq? (case-arity) 0))
+(assert (eq? (case-arity 1) 1))
+(assert (eq? (case-arity 1 2) 'rest))
+(assert (eq? (case-arity 1 2 3) 3))
+(assert (eq? (case-arity 1 2 3 4 5) 'rest))
+(assert (eq? (apply case-arity '(1 2 3)) 3))
+(define (case-closure x) (case-lambda (() x) ((y) (+ x y))))
+(assert (= ((case-closure 1)) 1))
+(assert (= ((case-closure 1) 2) (+ ((case-closure 1)) 2)))
+
+'deep-recursion
+(define (deep-list n) (if (= n 0) '() (cons n (deep-list (- n 1)))))
+(define (deep-sum lst) (if (null? lst) 0 (+ (car lst) (deep-sum (cdr lst)))))
+(assert (= (deep-sum (deep-list 100000)) 5000050000))
+
+'continuations
+(assert (= (call/ec (lambda (k) 5)) 5))
+(assert (= (call/ec (lambda (k) (+ 1 (k 42)))) 42))
+(assert (= (+ 1 (call/ec (lambda (k) (+ 10 (k 1))))) 2))
+(define (find-deep n k) (if (= n 0) (k 'found) (+ 1 (find-deep (- n 1) k))))
+(assert (eq? (call-with-escape-continuation (lambda (k) (find-deep 10000 k))) 'found))
+(assert (eq?
+  (call/ec (lambda (outer)
+    (+ 1 (call/ec (lambda (inner) (find-deep 100 outer))))))
+  'found))
+(define (first-negative lst)
+  (call/ec (lambda (return)
+    (define (walk lst)
+      (if (null? lst) #f
+        (if (@negative? (car lst)) (return (car lst)) (walk (cdr lst)))))
+    (walk lst))))
+(assert (= (first-negative '(1 2 -3 4)) -3))
+(assert (eq? (first-negative '(1 2)) #f))
+(assert (eq? (apply call/ec (list (lambda (k) (apply k '(ok))))) 'ok))
+
+'tail-calls
+(define (apply-loop n) (if (= n 0) 'done (apply apply-loop (list (- n 1)))))
+(assert (eq? (apply-loop 20000) 'done))
+(define (and-loop n) (and #t (if (= n 0) 'done (and-loop (- n 1)))))
+(assert (eq? (and-loop 20000) 'done))
+(define (or-loop n) (or (= n 0) (or-loop (- n 1))))
+(assert (eq? (or-loop 20000) #t))
+(define case-loop
+  (case-lambda
+    ((n) (case-loop n 0))
+    ((n acc) (if (= n 0) acc (case-loop (- n 1) (+ acc 1))))))
+(assert (= (case-loop 20000) 20000))
+(assert (= (apply + 1 2 '(3 4 5 6)) 21))
+(assert (= (apply apply (list + (list 1 2))) 3))
+(assert (= (apply + '()) 0))
+(assert (< 1 2 3 4 5 6 7 8))
+
+'local-frames
+(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))
+(define (garbage-of thunk) (garbage-collect) (thunk) (cadr (garbage-collect)))
+(assert (= (garbage-of (lambda () (fib 15))) 0))
+(define (keep-through-collection n)
+  (let ([lst (list n (+ n 1))]) (garbage-collect) (cadr lst)))
+(assert (= (keep-through-collection 7) 8))
+(define (counter) (let ([n 0]) (lambda () (set! n (+ n 1)) n)))
+(define count-up (counter))
+(count-up)
+(assert (= (count-up) 2))
+
+'native-arithmetic
+(assert (< 1 2 3 4))
+(assert (not (< 1 3 2 4)))
+(assert (> 4 3 2 1))
+(assert (<= 1 1 2 2))
+(assert (>= 2 2 1 1))
+(assert (= 2 2 2))
+(assert (eqv? 1.5 1.5 1.5))
+(assert (not (eq? 'a 'a 'b)))
+(define (plus a b) (+ a b))
+(define (plus-value a b) (let ([sum (+ a b)]) sum))
+(define saved-plus +)
+(set! + (lambda (a b) (list a b)))
+(assert (eq? (car (plus 'x 'y)) 'x))
+(assert (eq? (cadr (plus-value 'x 'y)) 'y))
+(set! + saved-plus)
+(assert (= (plus 1 2) 3))
+(define (shadowed - a b) (- a b))
+(assert (= (shadowed + 1 2) 3))
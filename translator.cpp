@@ -0,0 +1,412 @@
+#include "translator.h"
+#include "eval.h"
+#include "parser.h"
+#include "primitives.h"
+#include "err.h"
+#include "num.h"
+#include "int.h"
+#include "string.h"
+
+#include <cmath>
+#include <iomanip>
+
+// a C++ string literal with the characters of value
+static std::string quote(const std::string &value) {
+	std::ostringstream out;
+	out << '"';
+	for (unsigned char ch : value) {
+		if (ch == '"' || ch == '\\') {
+			out << '\\' << ch;
+		} else if (ch == '\n') {
+			out << "\\n";
+		} else if (ch < ' ' || ch >= 0x7f) {
+			out << '\\' << std::oct << std::setw(3) << std::setfill('0')
+				<< static_cast<unsigned>(ch) << std::dec;
+		} else { out << ch; }
+	}
+	out << '"';
+	return out.str();
+}
+
+std::string Translator::name(const char *prefix) {
+	return prefix + std::to_string(count_++);
+}
+
+std::string Translator::symbol(Symbol *sym) {
+	auto &result { names_[sym] };
+	if (result.empty()) {
+		result = name("s");
+		declarations_ << "static Symbol *" << result << ";\n";
+		setup_ << "\t" << result << " = Symbol::get(" << quote(sym->value()) << ");\n";
+	}
+	return result;
+}
+
+std::string Translator::cell(Cell *cell) {
+	auto &result { names_[cell] };
+	if (result.empty()) {
+		auto sym { symbol(cell->name()) };
+		result = name("g");
+		declarations_ << "static Cell *" << result << ";\n";
+		setup_ << "\t" << result << " = initial_frame->cell(" << sym << ");\n";
+	}
+	return result;
+}
+
+// data are built when the program starts
+// proper lists are built in one go, so the nesting of the C++
+// expression follows the nesting of the lists
+std::string Translator::datum(Obj *value) {
+	if (! value) { return "nullptr"; }
+	if (is_fixnum(value)) {
+		return "make_fixnum(" + std::to_string(fixnum_value(value)) + ")";
+	}
+	if (value == true_obj) { return "true_obj"; }
+	if (value == false_obj) { return "false_obj"; }
+	if (auto sym { as_symbol(value) }) { return symbol(sym); }
+	if (auto str { as_string(value) }) {
+		return "new String { " + quote(str->value()) + " }";
+	}
+	if (auto num { as_float(value) }) {
+		std::ostringstream out;
+		out << std::hexfloat << num->value();
+		if (std::isfinite(num->value())) {
+			return "new Float { " + out.str() + " }";
+		}
+	}
+	if (is_pair(value)) {
+		std::string elements;
+		for (; is_pair(value); value = cdr(value)) {
+			if (! elements.empty()) { elements += ", "; }
+			elements += datum(car(value));
+		}
+		return "Native::list({ " + elements + " }, " + datum(value) + ")";
+	}
+	switch (tag_of(value)) {
+		case Tag::integer: case Tag::fraction: case Tag::exact_complex:
+		case Tag::inexact_complex: case Tag::float_number: {
+			std::ostringstream out;
+			out << std::setprecision(17) << value;
+			return "parse_expression(" + quote(out.str()) + ")";
+		}
+		default:
+			err("translate", "no datum", value);
+			return { };
+	}
+}
+
+std::string Translator::constant(Obj *value) {
+	if (is_fixnum(value)) { return datum(value); }
+	if (! value || value == true_obj || value == false_obj || is_symbol(value)) {
+		return "static_cast<Obj *>(" + datum(value) + ")";
+	}
+	auto result { name("k") };
+	auto init { datum(value) };
+	declarations_ << "static Obj **" << result << ";\n";
+	setup_ << "\t" << result << " = &Native::keep(" << init << ");\n";
+	return "*" + result;
+}
+
+std::string Translator::function(const std::string &statements) {
+	auto result { name("f") };
+	functions_ << "static Node *" << result << "(Frame *&env, Obj *&value) {\n"
+		<< statements << "}\n\n";
+	return result;
+}
+
+std::string Translator::layout(Layout *layout) {
+	auto &result { names_[layout] };
+	if (! result.empty()) { return result; }
+	auto fn { function(tail(layout->code())) };
+	std::string names;
+	for (auto sym : layout->names()) {
+		if (! names.empty()) { names += ", "; }
+		names += symbol(sym);
+	}
+	auto init {
+		"Native::layout(" + datum(layout->params()) + ", " +
+		datum(layout->body()) + ", { " + names + " }, " + fn + ", " +
+		(layout->is_local() ? "true" : "false") + ")"
+	};
+	result = name("l");
+	declarations_ << "static Layout *" << result << ";\n";
+	setup_ << "\t" << result << " = " << init << ";\n";
+	return result;
+}
+
+std::string Translator::cases(Cases *cases) {
+	auto &result { names_[cases] };
+	if (! result.empty()) { return result; }
+	std::string layouts;
+	for (auto l : cases->layouts()) {
+		if (! layouts.empty()) { layouts += ", "; }
+		layouts += layout(l);
+	}
+	result = name("c");
+	declarations_ << "static Cases *" << result << ";\n";
+	setup_ << "\t" << result << " = Native::cases({ " << layouts << " });\n";
+	return result;
+}
+
+std::pair<std::string, std::string> Translator::primitive(Cell *cell) {
+	auto &result { names_[cell->value()] };
+	if (result.empty()) {
+		auto var { this->cell(cell) };
+		result = name("p");
+		declarations_ << "static Obj **" << result << ";\n"
+			"static Binary_Entry " << result << "_entry;\n";
+		setup_ << "\t" << result << " = &Native::keep(" << var << "->value());\n"
+			"\t" << result << "_entry = Native::binary_entry(*" << result << ");\n";
+	}
+	return { "*" + result, result + "_entry" };
+}
+
+// syntax extensions are defined when the program runs, too
+void Translator::add(Obj *exp) {
+	auto node { analyze(exp, initial_frame) };
+	auto lst { as_pair(exp) };
+	auto sym { lst ? as_symbol(car(lst)) : nullptr };
+	if (sym && sym->special() == Special::define_syntax) {
+		forms_.push_back(function(
+			"\tvalue = eval(" + constant(exp) + ", env);\n\treturn nullptr;\n"
+		));
+		return;
+	}
+	forms_.push_back(function(tail(node)));
+}
+
+void Translator::write(std::ostream &out) {
+	out << "#include \"native.h\"\n"
+		"#include \"runtime.h\"\n"
+		"#include \"primitives.h\"\n"
+		"#include \"parser.h\"\n"
+		"#include \"num.h\"\n"
+		"#include \"int.h\"\n"
+		"#include \"string.h\"\n\n"
+		<< declarations_.str() << '\n' << functions_.str()
+		<< "static void setup() {\n" << setup_.str() << "}\n\n"
+		"int main() {\n"
+		"\tsetup_runtime();\n"
+		"\tsetup();\n"
+		"\treturn Native::main({ ";
+	for (unsigned i { 0 }; i < forms_.size(); ++i) {
+		out << (i ? ", " : "") << forms_[i];
+	}
+	out << " });\n}\n";
+}
+
+void translate_stream(std::istream &in, Translator &translator) {
+	int ch = get(in);
+	if (ch == '#') {
+		while (ch != EOF && ch != '\n') { ch = get(in); }
+	}
+	for (;;) {
+		auto exp { read_expression(in) };
+		if (! in) { break; }
+		translator.add(exp);
+	}
+}
+
+std::string Node::translate_tail(Translator &t) {
+	return "\tvalue = " + translate(t) + ";\n\treturn nullptr;\n";
+}
+
+std::string Constant_Node::translate(Translator &t) {
+	return t.constant(value_);
+}
+
+std::string Local_Node::translate(Translator &t) {
+	return "env->get(" + std::to_string(depth_) + ", " +
+		std::to_string(slot_) + ", " + t.symbol(name_) + ")";
+}
+
+std::string Global_Node::translate(Translator &t) {
+	return "Native::global(" + t.cell(cell_) + ")";
+}
+
+std::string Set_Local_Node::translate(Translator &t) {
+	return "env->update(" + std::to_string(depth_) + ", " +
+		std::to_string(slot_) + ", " + t.symbol(name_) + ", " +
+		t.expression(value_) + ")";
+}
+
+std::string Set_Global_Node::translate(Translator &t) {
+	return "Native::set_global(" + t.cell(cell_) + ", " + t.expression(value_) + ")";
+}
+
+std::string Define_Local_Node::translate(Translator &t) {
+	return "Native::define(env, " + std::to_string(slot_) + ", " +
+		t.expression(value_) + ")";
+}
+
+std::string Define_Global_Node::translate(Translator &t) {
+	return "Native::define(" + t.cell(cell_) + ", " + t.expression(value_) + ")";
+}
+
+std::string If_Node::translate(Translator &t) {
+	return "(is_true(" + t.expression(condition_) + ") ? " +
+		t.expression(consequence_) + " : " + t.expression(alternative_) + ")";
+}
+
+std::string If_Node::translate_tail(Translator &t) {
+	return "\tif (is_true(" + t.expression(condition_) + ")) {\n" +
+		t.tail(consequence_) + "\t}\n" + t.tail(alternative_);
+}
+
+// simple nodes have no effect, they are only needed for their value
+static std::string effects(Translator &t, std::vector<Node *> &body) {
+	std::string result;
+	auto last { body.end() - 1 };
+	for (auto cur { body.begin() }; cur != last; ++cur) {
+		if (! (*cur)->is_simple()) { result += "\t" + t.expression(*cur) + ";\n"; }
+	}
+	return result;
+}
+
+std::string Sequence_Node::translate(Translator &t) {
+	return "[&]() -> Obj * {\n" + effects(t, body_) +
+		"\treturn " + t.expression(body_.back()) + ";\n}()";
+}
+
+std::string Sequence_Node::translate_tail(Translator &t) {
+	return effects(t, body_) + t.tail(body_.back());
+}
+
+// the tests before the last one end the evaluation with their value
+static std::string translate_tests(
+	Translator &t, std::vector<Node *> &tests, const char *stop,
+	const std::string &exit, const std::string &last
+) {
+	if (tests.size() == 1) { return last; }
+	auto var { t.temporary() };
+	std::string result { "\tObj *" + var + ";\n" };
+	for (auto cur { tests.begin() }; cur != tests.end() - 1; ++cur) {
+		result += std::string { "\tif (" } + stop + "(" + var + " = " +
+			t.expression(*cur) + ")) { " + exit + var + "; " +
+			(exit == "return " ? "" : "return nullptr; ") + "}\n";
+	}
+	return result + last;
+}
+
+std::string And_Node::translate(Translator &t) {
+	if (tests_.empty()) { return t.constant(true_obj); }
+	return "[&]() -> Obj * {\n" + translate_tests(t, tests_, "is_false", "return ",
+		"\treturn " + t.expression(tests_.back()) + ";\n") + "}()";
+}
+
+std::string And_Node::translate_tail(Translator &t) {
+	if (tests_.empty()) { return Node::translate_tail(t); }
+	return translate_tests(t, tests_, "is_false", "value = ", t.tail(tests_.back()));
+}
+
+std::string Or_Node::translate(Translator &t) {
+	if (tests_.empty()) { return t.constant(false_obj); }
+	return "[&]() -> Obj * {\n" + translate_tests(t, tests_, "is_true", "return ",
+		"\treturn " + t.expression(tests_.back()) + ";\n") + "}()";
+}
+
+std::string Or_Node::translate_tail(Translator &t) {
+	if (tests_.empty()) { return Node::translate_tail(t); }
+	return translate_tests(t, tests_, "is_true", "value = ", t.tail(tests_.back()));
+}
+
+std::string Lambda_Node::translate(Translator &t) {
+	return "Native::closure(env, " + t.cases(cases_) + ")";
+}
+
+std::string Assert_Node::translate(Translator &t) {
+	return "Native::check(" + t.expression(condition_) + ", " +
+		t.constant(form_) + ")";
+}
+
+// the values that are computed before the last call must be rooted
+// because the call can collect garbage; the value of the call itself
+// and the simple values after it are used directly
+// returns the statements that compute the rooted values and the list
+// of the values
+static std::pair<std::string, std::vector<std::string>> values(
+	Translator &t, std::vector<Node *> &nodes
+) {
+	unsigned calling { 0 };
+	for (unsigned i { 0 }; i < nodes.size(); ++i) {
+		if (! nodes[i]->is_simple()) { calling = i + 1; }
+	}
+	std::string init;
+	std::vector<std::string> values;
+	for (unsigned i { 0 }; i < nodes.size(); ++i) {
+		auto value { t.expression(nodes[i]) };
+		if (i < calling) {
+			auto var { t.temporary() };
+			init += "\tObj *" + var + " { " + value + " };\n";
+			if (i + 1 < calling) { init += "\tRoot " + var + "_root { " + var + " };\n"; }
+			value = var;
+		}
+		values.push_back(value);
+	}
+	return { init, values };
+}
+
+static std::string join(std::vector<std::string>::iterator begin, std::vector<std::string>::iterator end) {
+	std::string result;
+	for (auto cur { begin }; cur != end; ++cur) {
+		result += (cur != begin ? ", " : "") + *cur;
+	}
+	return result;
+}
+
+// an expression that needs statements becomes a lambda that is called
+// immediately
+static std::string immediate(const std::string &init, const std::string &value) {
+	if (init.empty()) { return value; }
+	return "[&]() -> Obj * {\n" + init + "\treturn " + value + ";\n}()";
+}
+
+static std::string block(const std::string &init, const std::string &node) {
+	return "\t{\n" + init + "\treturn " + node + ";\n\t}\n";
+}
+
+std::string Let_Node::translate(Translator &t) {
+	auto [init, args] { values(t, args_) };
+	return immediate(init, "Native::let(env, " + t.layout(layout_) + ", { " +
+		join(args.begin(), args.end()) + " })");
+}
+
+std::string Let_Node::translate_tail(Translator &t) {
+	auto [init, args] { values(t, args_) };
+	return block(init, "Native::enter(env, " + t.layout(layout_) + ", { " +
+		join(args.begin(), args.end()) + " })");
+}
+
+static std::pair<std::string, std::string> application(
+	Translator &t, Node *function, std::vector<Node *> &args
+) {
+	std::vector<Node *> nodes { function };
+	nodes.insert(nodes.end(), args.begin(), args.end());
+	auto [init, list] { values(t, nodes) };
+	return { init, list[0] + ", { " + join(list.begin() + 1, list.end()) + " }" };
+}
+
+std::string Application_Node::translate(Translator &t) {
+	auto [init, args] { application(t, function_, args_) };
+	return immediate(init, "Native::call(" + args + ")");
+}
+
+std::string Application_Node::translate_tail(Translator &t) {
+	auto [init, args] { application(t, function_, args_) };
+	return block(init, "Native::tail_call(env, value, " + args + ")");
+}
+
+std::string Binary_Call_Node::translate(Translator &t) {
+	auto [primitive, entry] { t.primitive(cell_) };
+	auto [init, args] { values(t, args_) };
+	return immediate(init, "Native::call_binary(" + primitive + ", " + entry +
+		", " + t.expression(function_) + ", " + join(args.begin(), args.end()) + ")");
+}
+
+std::string Binary_Call_Node::translate_tail(Translator &t) {
+	auto [primitive, entry] { t.primitive(cell_) };
+	auto [init, args] { values(t, args_) };
+	return block(init, "Native::tail_call_binary(env, value, " + primitive + ", " +
+		entry + ", " + t.expression(function_) + ", " +
+		join(args.begin(), args.end()) + ")");
+}
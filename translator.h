@@ -0,0 +1,60 @@
+/**
+ * translate Scheme programs to C++
+ * the top-level expressions are analyzed like for the interpreter and
+ * the nodes are translated to C++ functions, see native.h
+ * the program is linked with the runtime of the interpreter, so
+ * everything besides the translated expressions works like in the
+ * interpreter
+ * the translation does not evaluate anything; syntax extensions are
+ * defined during the analysis and again when the program runs
+ */
+
+#pragma once
+
+#include "node.h"
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class Translator {
+		std::ostringstream declarations_;
+		std::ostringstream functions_;
+		std::ostringstream setup_;
+		std::vector<std::string> forms_;
+		std::map<Obj *, std::string> names_;
+		unsigned count_ { 0 };
+
+		std::string name(const char *prefix);
+		std::string datum(Obj *value);
+		std::string function(const std::string &statements);
+	public:
+		// C++ variables that hold the object after the setup
+		std::string symbol(Symbol *sym);
+		std::string cell(Cell *cell);
+		std::string layout(Layout *layout);
+		std::string cases(Cases *cases);
+		// the primitive that the cell holds when the program starts
+		// and its binary entry
+		std::pair<std::string, std::string> primitive(Cell *cell);
+
+		// C++ expression of the constant value
+		std::string constant(Obj *value);
+
+		// a variable for a temporary value
+		std::string temporary() { return name("t"); }
+
+		std::string expression(Node *node) { return node->translate(*this); }
+		std::string tail(Node *node) { return node->translate_tail(*this); }
+
+		// analyze and add a top-level expression
+		void add(Obj *exp);
+
+		// the C++ program
+		void write(std::ostream &out);
+};
+
+// translate the expressions in the stream
+void translate_stream(std::istream &in, Translator &translator);
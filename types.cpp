@@ -1,21 +1,86 @@
 #include "types.h"
 #include "num.h"
 #include "err.h"
+#include "stack.h"
 
-Symbol::~Symbol() {
-	auto it { symbols_.find(value_) };
-	if (it != symbols_.end()) { symbols_.erase(it); }
+#include <iterator>
+
+static const char *special_names[] {
+	"", "define", "define-syntax", "syntax-rules", "lambda", "case-lambda",
+	"if", "cond", "else", "begin", "and", "or", "quote", "let", "set!",
+	"assert"
+};
+
+Symbol::Symbol(const std::string &value, std::size_t hash):
+	Obj { Tag::symbol }, value_ { value }, hash_ { hash },
+	special_ { Special::none }
+{
+	for (unsigned i { 1 }; i < std::size(special_names); ++i) {
+		if (value_ == special_names[i]) {
+			special_ = static_cast<Special>(i);
+		}
+	}
+}
+
+void Symbol::grow() {
+	std::vector<Symbol *> old { std::move(table_) };
+	table_.assign(old.empty() ? 256 : old.size() * 2, nullptr);
+	auto mask { table_.size() - 1 };
+	for (auto sym : old) {
+		if (! sym) { continue; }
+		auto i { sym->hash_ & mask };
+		while (table_[i]) { i = (i + 1) & mask; }
+		table_[i] = sym;
+	}
 }
 
 Symbol *Symbol::get(const std::string &value) {
-	auto it { symbols_.find(value) };
-	if (it != symbols_.end()) { return it->second; }
-	auto sym { new Symbol { value } };
-	symbols_[value] = sym;
+	auto hash { std::hash<std::string> { }(value) };
+	if (2 * (count_ + 1) > table_.size()) { grow(); }
+	auto mask { table_.size() - 1 };
+	auto i { hash & mask };
+	for (; table_[i]; i = (i + 1) & mask) {
+		auto sym { table_[i] };
+		if (sym->hash_ == hash && sym->value_ == value) { return sym; }
+	}
+	auto sym { new Symbol { value, hash } };
+	table_[i] = sym;
+	++count_;
+	return sym;
+}
+
+Symbol *Symbol::get(Special special) {
+	static Symbol *symbols[std::size(special_names)] { };
+	auto &sym { symbols[static_cast<unsigned>(special)] };
+	if (! sym) { sym = get(special_names[static_cast<unsigned>(special)]); }
 	return sym;
 }
 
-std::map<std::string, Symbol *> Symbol::symbols_;
+// follow the rest of a list directly instead of pushing every
+// pair onto the gray stack; long lists are split into chunks
+void Pair::propagate_mark() {
+	constexpr unsigned chunk_size { 256 };
+	Pair *cell { this };
+	for (unsigned count { 1 }; ; ++count) {
+		__builtin_prefetch(cell->rest_);
+		mark(cell->head_);
+		if (count == chunk_size || ! is_pair(cell->rest_)) {
+			mark(cell->rest_);
+			return;
+		}
+		if (! claim(cell->rest_)) { return; }
+		cell = static_cast<Pair *>(cell->rest_);
+	}
+}
+
+void Symbol::foreach(std::function<void(Symbol *)> fn) {
+	for (auto sym : table_) {
+		if (sym) { fn(sym); }
+	}
+}
+
+std::vector<Symbol *> Symbol::table_;
+std::size_t Symbol::count_ { 0 };
 
 False *false_obj = new False {};
 True *true_obj = new True {};
@@ -102,14 +167,23 @@ void write_inner_complex_pair(std::ostream &out, Pair *pair, std::string indent)
 }
 
 static void write_complex_pair(std::ostream &out, Pair *pair, std::string indent) {
+	if (Stack::is_low()) {
+		return Stack::extend([&]() { write_complex_pair(out, pair, indent); });
+	}
+	Stack::Depth_Guard depth_guard;
 	out << '('; write_inner_complex_pair(out, pair,indent); out << ')';
 }
 
 std::ostream &Pair::write(std::ostream &out) {
+	if (Stack::is_low()) {
+		Stack::extend([&]() { write(out); });
+		return out;
+	}
+	Stack::Depth_Guard depth_guard;
 	auto sym { as_symbol(head_) };
 	if (sym && sym->value() == "quote") {
 		out << "'";
-		return car(rest_)->write(out);
+		return out << car(rest_);
 	}
 
 	if (is_complicated(this)) {
@@ -8,16 +8,33 @@
 
 #include "dynamic.h"
 
-#include <map>
+#include <functional>
+#include <string>
 
+// symbols of the special forms and their keywords are known by an id
+enum class Special : unsigned char {
+	none, define, define_syntax, syntax_rules, lambda, case_lambda,
+	if_, cond, else_, begin, and_, or_, quote, let, set, assert_
+};
+
+// symbols are never collected; they are kept in a hash table with
+// open addressing
 class Symbol : public Obj {
-		static std::map<std::string, Symbol *>symbols_;
+		static std::vector<Symbol *> table_;
+		static std::size_t count_;
 		std::string value_;
-		Symbol(const std::string &value): value_ { value } { }
+		std::size_t hash_;
+		Special special_;
+		Symbol(const std::string &value, std::size_t hash);
+		static void grow();
 	public:
-		~Symbol();
+		static constexpr Tag first_tag { Tag::symbol };
+		static constexpr Tag last_tag { Tag::symbol };
 		static Symbol *get(const std::string &value);
+		static Symbol *get(Special special);
+		static void foreach(std::function<void(Symbol *)> fn);
 		const std::string &value() const { return value_; }
+		Special special() const { return special_; }
 		std::ostream &write(std::ostream &out) { return out << value_; }
 };
 
@@ -49,18 +66,33 @@ class Pair : public Obj {
 		Obj *head_;
 		Obj *rest_;
 	protected:
-		void propagate_mark() override { mark(head_); mark(rest_); }
+		void propagate_mark() override;
+		void forward_references() override {
+			forward(head_); forward(rest_);
+		}
 	public:
-		Pair(Obj *head, Obj *rest): head_ { head }, rest_ { rest } { }
+		static constexpr Tag first_tag { Tag::pair };
+		static constexpr Tag last_tag { Tag::pair };
+		Pair(Obj *head, Obj *rest):
+			Obj { Tag::pair }, head_ { head }, rest_ { rest } { }
+		static void *operator new(std::size_t size) {
+			return Heap::allocate_pair(size);
+		}
 		Obj *head() const { return head_; }
 		Obj *rest() const { return rest_; }
-		void set_head(Obj *head) { head_ = head; }
-		void set_rest(Obj *rest) { rest_ = rest; }
+		void set_head(Obj *head) { write_barrier(head_, head); head_ = head; }
+		void set_rest(Obj *rest) { write_barrier(rest_, rest); rest_ = rest; }
 		std::ostream &write(std::ostream &out) override;
 };
 
-constexpr auto as_pair = Dynamic::as<Pair>;
-constexpr auto is_pair = Dynamic::is<Pair>;
+inline bool is_pair(Obj *obj) {
+	return obj && ! is_immediate(obj) &&
+		Heap::kind_of(obj) == Heap::Kind::pairs;
+}
+
+inline Pair *as_pair(Obj *obj) {
+	return is_pair(obj) ? static_cast<Pair *>(obj) : nullptr;
+}
 inline bool is_null(Obj *element) { return ! element; }
 
 Obj *car(Obj *obj);
@@ -2,11 +2,13 @@
 
 #include "obj.h"
 
-template<typename VALUE_TYPE, typename BASE = Obj>
+template<typename VALUE_TYPE, typename BASE = Obj, Tag TAG = Tag::other>
 class Value_Element : public BASE {
 		VALUE_TYPE value_;
 	public:
-		Value_Element(const VALUE_TYPE &value): value_ { value } { }
+		static constexpr Tag first_tag { TAG };
+		static constexpr Tag last_tag { TAG };
+		Value_Element(const VALUE_TYPE &value): BASE { TAG }, value_ { value } { }
 		const VALUE_TYPE &value() const { return value_; }
 		std::ostream &write(std::ostream &out) override {
 			return out << value_;
@@ -0,0 +1,426 @@
+#include "vm.h"
+#include "stack.h"
+#include "err.h"
+
+#include <algorithm>
+
+std::uint32_t Compiler::constant(Obj *value) {
+	for (std::uint32_t i { 0 }; i < constants_.size(); ++i) {
+		if (constants_[i] == value) { return i; }
+	}
+	constants_.push_back(value);
+	return constants_.size() - 1;
+}
+
+Code *Compiler::finish() {
+	return new Code { std::move(ops_), std::move(constants_) };
+}
+
+Code *compile(Node *node) {
+	Compiler c;
+	node->compile_tail(c);
+	return c.finish();
+}
+
+void Node::compile_tail(Compiler &c) {
+	compile(c);
+	c.emit(Op::ret);
+}
+
+void Constant_Node::compile(Compiler &c) {
+	c.emit(Op::constant, c.constant(value_));
+}
+
+void Local_Node::compile(Compiler &c) {
+	c.emit(Op::local, depth_, slot_, c.constant(name_));
+}
+
+void Global_Node::compile(Compiler &c) {
+	c.emit(Op::global, c.constant(cell_));
+}
+
+void Set_Local_Node::compile(Compiler &c) {
+	value_->compile(c);
+	c.emit(Op::set_local, depth_, slot_, c.constant(name_));
+}
+
+void Set_Global_Node::compile(Compiler &c) {
+	value_->compile(c);
+	c.emit(Op::set_global, c.constant(cell_));
+}
+
+void Define_Local_Node::compile(Compiler &c) {
+	value_->compile(c);
+	c.emit(Op::define_local, slot_);
+}
+
+void Define_Global_Node::compile(Compiler &c) {
+	value_->compile(c);
+	c.emit(Op::define_global, c.constant(cell_));
+}
+
+void If_Node::compile(Compiler &c) {
+	condition_->compile(c);
+	auto to_alternative { c.jump(Op::jump_if_false) };
+	consequence_->compile(c);
+	auto to_end { c.jump(Op::jump) };
+	c.land(to_alternative);
+	alternative_->compile(c);
+	c.land(to_end);
+}
+
+void If_Node::compile_tail(Compiler &c) {
+	condition_->compile(c);
+	auto to_alternative { c.jump(Op::jump_if_false) };
+	consequence_->compile_tail(c);
+	c.land(to_alternative);
+	alternative_->compile_tail(c);
+}
+
+void Sequence_Node::compile(Compiler &c) {
+	auto last { body_.end() - 1 };
+	for (auto cur { body_.begin() }; cur != last; ++cur) {
+		(*cur)->compile(c);
+		c.emit(Op::pop);
+	}
+	(*last)->compile(c);
+}
+
+void Sequence_Node::compile_tail(Compiler &c) {
+	auto last { body_.end() - 1 };
+	for (auto cur { body_.begin() }; cur != last; ++cur) {
+		(*cur)->compile(c);
+		c.emit(Op::pop);
+	}
+	(*last)->compile_tail(c);
+}
+
+// the value that ends the evaluation stays on the stack
+// in tail position the last test is compiled as a tail and the other
+// tests return their value
+static void compile_tests(
+	Compiler &c, std::vector<Node *> &tests, Op op, Obj *empty, bool tail
+) {
+	if (tests.empty()) {
+		c.emit(Op::constant, c.constant(empty));
+		if (tail) { c.emit(Op::ret); }
+		return;
+	}
+	std::vector<std::size_t> to_end;
+	auto last { tests.end() - 1 };
+	for (auto cur { tests.begin() }; cur != last; ++cur) {
+		(*cur)->compile(c);
+		to_end.push_back(c.jump(op));
+	}
+	if (tail) { (*last)->compile_tail(c); } else { (*last)->compile(c); }
+	for (auto jump : to_end) { c.land(jump); }
+	if (tail && ! to_end.empty()) { c.emit(Op::ret); }
+}
+
+void And_Node::compile(Compiler &c) {
+	compile_tests(c, tests_, Op::jump_if_false_or_pop, true_obj, false);
+}
+
+void And_Node::compile_tail(Compiler &c) {
+	compile_tests(c, tests_, Op::jump_if_false_or_pop, true_obj, true);
+}
+
+void Or_Node::compile(Compiler &c) {
+	compile_tests(c, tests_, Op::jump_if_true_or_pop, false_obj, false);
+}
+
+void Or_Node::compile_tail(Compiler &c) {
+	compile_tests(c, tests_, Op::jump_if_true_or_pop, false_obj, true);
+}
+
+void Lambda_Node::compile(Compiler &c) {
+	c.emit(Op::closure, c.constant(this));
+}
+
+void Assert_Node::compile(Compiler &c) {
+	condition_->compile(c);
+	c.emit(Op::assert_, c.constant(form_));
+}
+
+void Let_Node::compile(Compiler &c) {
+	for (auto arg : args_) { arg->compile(c); }
+	c.emit(Op::enter, c.constant(layout_), args_.size());
+}
+
+void Let_Node::compile_tail(Compiler &c) {
+	for (auto arg : args_) { arg->compile(c); }
+	c.emit(Op::tail_enter, c.constant(layout_), args_.size());
+}
+
+void Application_Node::compile(Compiler &c) {
+	function_->compile(c);
+	for (auto arg : args_) { arg->compile(c); }
+	c.emit(Op::call, args_.size());
+}
+
+void Application_Node::compile_tail(Compiler &c) {
+	function_->compile(c);
+	for (auto arg : args_) { arg->compile(c); }
+	c.emit(Op::tail_call, args_.size());
+}
+
+// the function is pushed, so that the machine can fall back to a call
+void Binary_Call_Node::compile(Compiler &c) {
+	function_->compile(c);
+	for (auto arg : args_) { arg->compile(c); }
+	c.emit(Op::call_binary, c.constant(this));
+}
+
+void Binary_Call_Node::compile_tail(Compiler &c) {
+	function_->compile(c);
+	for (auto arg : args_) { arg->compile(c); }
+	c.emit(Op::tail_call_binary, c.constant(this));
+}
+
+namespace {
+	// the local frames above frames belong to the activation
+	struct Activation {
+		Code *code;
+		const std::uint32_t *ip;
+		Frame *env;
+		std::size_t frames;
+	};
+
+	std::vector<Obj *> stack;
+	std::vector<Activation> activations;
+
+	// drops the state of a machine that is left by an exception
+	class Unwind {
+			std::size_t stack_size_;
+			std::size_t activations_size_;
+		public:
+			Unwind():
+				stack_size_ { stack.size() },
+				activations_size_ { activations.size() }
+			{ }
+			~Unwind() {
+				stack.resize(stack_size_);
+				activations.resize(activations_size_);
+			}
+	};
+
+	Code *bytecode(Layout *layout) {
+		if (! layout->bytecode()) {
+			layout->set_bytecode(compile(layout->code()));
+		}
+		return layout->bytecode();
+	}
+}
+
+void foreach_vm_root(std::function<void(Obj *)> fn) {
+	for (auto obj : stack) {
+		if (obj && ! is_immediate(obj)) { fn(obj); }
+	}
+	for (auto &activation : activations) {
+		fn(activation.code);
+		fn(activation.env);
+	}
+}
+
+
+Obj *execute(Layout *layout, Frame *env) {
+	return execute(bytecode(layout), env);
+}
+
+#define NEXT goto *dispatch[*ip++]
+
+Obj *execute(Code *code, Frame *env) {
+	static void *const dispatch[] {
+		&&op_constant, &&op_local, &&op_global, &&op_set_local,
+		&&op_set_global, &&op_define_local, &&op_define_global, &&op_pop,
+		&&op_jump, &&op_jump_if_false, &&op_jump_if_false_or_pop,
+		&&op_jump_if_true_or_pop, &&op_closure, &&op_assert, &&op_call,
+		&&op_tail_call, &&op_call_binary, &&op_tail_call_binary, &&op_enter,
+		&&op_tail_enter, &&op_ret
+	};
+	if (Stack::is_low()) {
+		return Stack::extend([=]() { return execute(code, env); });
+	}
+	Stack::Depth_Guard depth_guard;
+	Unwind unwind;
+	Local_Frames::Guard local_guard;
+	auto base { activations.size() };
+	const std::uint32_t *ip { code->ops() };
+	activations.push_back({ code, ip, env, Local_Frames::top() });
+	Obj *value;
+	std::uint32_t count;
+	std::size_t frames;
+	bool tail;
+	NEXT;
+
+op_constant:
+	stack.push_back(code->constant(*ip++));
+	NEXT;
+op_local:
+	stack.push_back(env->get(
+		ip[0], ip[1], static_cast<Symbol *>(code->constant(ip[2]))
+	));
+	ip += 3;
+	NEXT;
+op_global: {
+		auto cell { static_cast<Cell *>(code->constant(*ip++)) };
+		stack.push_back(cell->is_bound() ? cell->value() : cell->name());
+	}
+	NEXT;
+op_set_local:
+	stack.back() = env->update(
+		ip[0], ip[1], static_cast<Symbol *>(code->constant(ip[2])),
+		stack.back()
+	);
+	ip += 3;
+	NEXT;
+op_set_global: {
+		auto cell { static_cast<Cell *>(code->constant(*ip++)) };
+		if (! cell->is_bound()) { err("update", "not found", cell->name()); }
+		cell->set(stack.back());
+	}
+	NEXT;
+op_define_local:
+	env->define(*ip++, stack.back());
+	NEXT;
+op_define_global:
+	static_cast<Cell *>(code->constant(*ip++))->set(stack.back());
+	NEXT;
+op_pop:
+	stack.pop_back();
+	NEXT;
+op_jump:
+	ip = code->ops() + *ip;
+	NEXT;
+op_jump_if_false:
+	value = stack.back();
+	stack.pop_back();
+	if (is_false(value)) { ip = code->ops() + *ip; } else { ++ip; }
+	NEXT;
+op_jump_if_false_or_pop:
+	if (is_false(stack.back())) {
+		ip = code->ops() + *ip;
+	} else { stack.pop_back(); ++ip; }
+	NEXT;
+op_jump_if_true_or_pop:
+	if (is_true(stack.back())) {
+		ip = code->ops() + *ip;
+	} else { stack.pop_back(); ++ip; }
+	NEXT;
+op_closure:
+	stack.push_back(static_cast<Node *>(code->constant(*ip++))->execute(env));
+	NEXT;
+op_assert:
+	if (is_false(stack.back())) { err("assert", "failed", code->constant(*ip)); }
+	++ip;
+	stack.back() = Symbol::get("ok");
+	NEXT;
+op_enter:
+	tail = false;
+	goto enter;
+op_tail_enter:
+	tail = true;
+enter:
+	{
+		auto layout { static_cast<Layout *>(code->constant(ip[0])) };
+		count = ip[1];
+		ip += 2;
+		auto first { stack.size() - count };
+		frames = Local_Frames::top();
+		env = Frame::create(env, layout);
+		for (std::uint32_t i { 0 }; i < count; ++i) { env->init(i, stack[first + i]); }
+		stack.resize(first);
+		code = bytecode(layout);
+	}
+activate:
+	if (tail) {
+		auto &activation { activations.back() };
+		activation.code = code;
+		activation.ip = code->ops();
+		activation.env = env;
+		Local_Frames::tail_call(activation.frames, env);
+	} else {
+		if (activations.size() > Stack::max_depth) { Stack::too_deep(); }
+		activations.back().ip = ip;
+		activations.push_back({ code, code->ops(), env, frames });
+	}
+	ip = code->ops();
+	// the whole state is in the stacks
+	Obj::collect_if_due();
+	NEXT;
+op_call_binary:
+	tail = false;
+	goto call_binary;
+op_tail_call_binary:
+	tail = true;
+call_binary:
+	{
+		auto node { static_cast<Binary_Call_Node *>(code->constant(*ip++)) };
+		count = 2;
+		auto fn_pos { stack.size() - 3 };
+		if (stack[fn_pos] != node->primitive()) { goto spread; }
+		// the values stay rooted on the stack during the call
+		value = node->entry()(stack[fn_pos + 1], stack[fn_pos + 2]);
+		stack.resize(fn_pos);
+		stack.push_back(value);
+	}
+	if (! tail) { NEXT; }
+	goto op_ret;
+op_call:
+	tail = false;
+	goto call;
+op_tail_call:
+	tail = true;
+call:
+	count = *ip++;
+spread:
+	{
+		auto fn_pos { stack.size() - count - 1 };
+		Obj *fn { stack[fn_pos] };
+		if (fn == apply_primitive) {
+			// call the function of apply with the spread arguments
+			ASSERT(count >= 2, "apply");
+			Obj *rest { stack.back() };
+			stack.pop_back();
+			stack.erase(stack.begin() + fn_pos);
+			count -= 2;
+			for (; is_pair(rest); rest = cdr(rest)) {
+				stack.push_back(car(rest));
+				++count;
+			}
+			ASSERT(is_null(rest), "apply");
+			goto spread;
+		}
+		if (auto proc { as_procedure(fn) }) {
+			auto layout { proc->select(&stack[fn_pos + 1], count) };
+			frames = Local_Frames::top();
+			env = proc->build_env(layout, &stack[fn_pos + 1], count);
+			stack.resize(fn_pos);
+			code = bytecode(layout);
+			goto activate;
+		}
+		auto function { as_function(fn) };
+		ASSERT(function, "apply");
+		{
+			// the function may run the machine, which can move the stack
+			Arguments arguments { count };
+			std::copy_n(&stack[fn_pos + 1], count, arguments.values());
+			stack.resize(fn_pos + 1);
+			value = function->apply_values(arguments.values(), count);
+		}
+		stack.resize(fn_pos);
+		stack.push_back(value);
+	}
+	if (! tail) { NEXT; }
+op_ret:
+	value = stack.back();
+	stack.pop_back();
+	Local_Frames::cut(activations.back().frames);
+	activations.pop_back();
+	if (activations.size() == base) { return value; }
+	code = activations.back().code;
+	ip = activations.back().ip;
+	env = activations.back().env;
+	stack.push_back(value);
+	NEXT;
+}
@@ -0,0 +1,96 @@
+/**
+ * bytecode engine
+ * the analyzed nodes are compiled into the code of a stack machine
+ * the machine keeps its values and its activations in stacks of its
+ * own; calls in tail position replace the current activation
+ * procedures are compiled when the machine calls them the first time
+ */
+
+#pragma once
+
+#include "eval.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// the operands follow the operation in the code
+enum class Op : std::uint32_t {
+	constant,		// index of constant
+	local,			// depth, slot, index of name
+	global,			// index of cell
+	set_local,		// depth, slot, index of name
+	set_global,		// index of cell
+	define_local,		// slot
+	define_global,		// index of cell
+	pop,
+	jump,			// target
+	jump_if_false,		// target
+	jump_if_false_or_pop,	// target
+	jump_if_true_or_pop,	// target
+	closure,		// index of lambda or native node
+	assert_,		// index of form
+	call,			// argument count
+	tail_call,		// argument count
+	call_binary,		// index of binary call node
+	tail_call_binary,	// index of binary call node
+	enter,			// index of layout, value count
+	tail_enter,		// index of layout, value count
+	ret
+};
+
+class Code : public Obj {
+		std::vector<std::uint32_t> ops_;
+		std::vector<Obj *> constants_;
+	protected:
+		void propagate_mark() override {
+			for (auto obj : constants_) { mark(obj); }
+		}
+		void forward_references() override {
+			for (auto &obj : constants_) { forward(obj); }
+		}
+	public:
+		static constexpr Tag first_tag { Tag::code };
+		static constexpr Tag last_tag { Tag::code };
+		Code(std::vector<std::uint32_t> &&ops, std::vector<Obj *> &&constants):
+			Obj { Tag::code }, ops_ { std::move(ops) },
+			constants_ { std::move(constants) } { }
+		const std::uint32_t *ops() const { return ops_.data(); }
+		Obj *constant(std::uint32_t idx) const { return constants_[idx]; }
+		std::ostream &write(std::ostream &out) override {
+			return out << "#code";
+		}
+};
+
+constexpr auto as_code = Dynamic::as<Code>;
+
+class Compiler {
+		std::vector<std::uint32_t> ops_;
+		std::vector<Obj *> constants_;
+	public:
+		void emit(Op op) { ops_.push_back(static_cast<std::uint32_t>(op)); }
+		void emit(Op op, std::uint32_t operand) {
+			emit(op); ops_.push_back(operand);
+		}
+		void emit(Op op, std::uint32_t first, std::uint32_t second) {
+			emit(op, first); ops_.push_back(second);
+		}
+		void emit(Op op, std::uint32_t first, std::uint32_t second, std::uint32_t third) {
+			emit(op, first); ops_.push_back(second); ops_.push_back(third);
+		}
+		std::uint32_t constant(Obj *value);
+
+		// emits a jump whose target is set by land
+		std::size_t jump(Op op) { emit(op, 0); return ops_.size() - 1; }
+		void land(std::size_t jump) { ops_[jump] = ops_.size(); }
+
+		Code *finish();
+};
+
+// the code that returns the value of node
+Code *compile(Node *node);
+
+Obj *execute(Code *code, Frame *env);
+Obj *execute(Layout *layout, Frame *env);
+
+void foreach_vm_root(std::function<void(Obj *)> fn);